@@ -0,0 +1,358 @@
+/******************************************************************************
+ *    FILE: Bench.c                                                           *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*************************************************************
+ * A benchmark of every sort over sizes from 1e2 up and over *
+ * several input distributions.  Every output is checked and *
+ * the results are written as CSV, with hardware counters    *
+ * from perf_event_open when the kernel lets us have them.   *
+ *************************************************************/
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "sort.h"
+
+/* Largest size the quadratic sorts are run at. */
+#define QUADRATIC_MAX 10000
+
+/*
+ * Small sizes are sorted again until about this many elements are done, a
+ * hundred times less for the quadratic sorts.
+ */
+#define ELEMENTS_PER_RUN 10000000
+
+/* The hardware counters, -1 in fds when one could not be opened. */
+#define COUNTERS 4
+static unsigned long long const counter_configs[COUNTERS] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_BRANCH_MISSES,
+	PERF_COUNT_HW_CACHE_MISSES
+};
+static int counter_fds[COUNTERS];
+
+/* Threads for the parallel sort. */
+static unsigned threads;
+
+static int compare(void const *a, void const *b)
+{
+	int32_t x = *(int32_t const*)a;
+	int32_t y = *(int32_t const*)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Every sort is run through one of these. */
+static void run_insertion(int32_t *arr, size_t n)
+{
+	insertion_sort(arr, n, sizeof(int32_t), compare);
+}
+
+static void run_selection(int32_t *arr, size_t n)
+{
+	selection_sort(arr, n, sizeof(int32_t), compare);
+}
+
+static void run_merge(int32_t *arr, size_t n)
+{
+	merge_sort(arr, n, sizeof(int32_t), compare);
+}
+
+static void run_tim(int32_t *arr, size_t n)
+{
+	tim_sort(arr, n, sizeof(int32_t), compare);
+}
+
+static void run_pdq(int32_t *arr, size_t n)
+{
+	pdq_sort(arr, n, sizeof(int32_t), compare);
+}
+
+static void run_heap(int32_t *arr, size_t n)
+{
+	heap_sort(arr, n, sizeof(int32_t), compare);
+}
+
+static void run_insertion_int32(int32_t *arr, size_t n)
+{
+	insertion_sort_int32(arr, n);
+}
+
+static void run_merge_int32(int32_t *arr, size_t n)
+{
+	merge_sort_int32(arr, n);
+}
+
+static void run_radix_int32(int32_t *arr, size_t n)
+{
+	radix_sort_int32(arr, n);
+}
+
+static void run_parallel(int32_t *arr, size_t n)
+{
+	parallel_merge_sort_int32(arr, n, threads);
+}
+
+struct Sort {
+	char const *name;
+	void (*run)(int32_t*, size_t);
+	int quadratic;
+};
+
+static struct Sort const sorts[] = {
+	{ "insertion_sort", run_insertion, 1 },
+	{ "selection_sort", run_selection, 1 },
+	{ "insertion_sort_int32", run_insertion_int32, 1 },
+	{ "merge_sort", run_merge, 0 },
+	{ "tim_sort", run_tim, 0 },
+	{ "pdq_sort", run_pdq, 0 },
+	{ "heap_sort", run_heap, 0 },
+	{ "merge_sort_int32", run_merge_int32, 0 },
+	{ "radix_sort_int32", run_radix_int32, 0 },
+	{ "parallel_merge_sort", run_parallel, 0 }
+};
+
+/* State of the random number generator, fixed so every run sees the same. */
+static uint64_t seed = 88172645463325252ULL;
+
+/* Returns the next number of a xorshift64 generator. */
+static uint64_t next_random(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	return seed;
+}
+
+static char const *const distributions[] = {
+	"random", "sorted", "reversed", "few-unique", "organ-pipe", "sawtooth"
+};
+
+/* Fills arr with n ints of the given distribution. */
+static void generate(int32_t *arr, size_t n, size_t distribution)
+{
+	size_t tooth = n / 16 + 1;
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		switch (distribution) {
+		case 0: arr[i] = (int32_t)next_random(); break;
+		case 1: arr[i] = i; break;
+		case 2: arr[i] = n - i; break;
+		case 3: arr[i] = next_random() % 16; break;
+		case 4: arr[i] = i < n / 2 ? i : n - i; break;
+		case 5: arr[i] = i % tooth; break;
+		}
+	}
+}
+
+/*
+ * Returns a hash of the ints in arr that does not depend on their order, so
+ * a sort that loses or makes up elements is caught.
+ */
+static uint64_t fingerprint(int32_t const *arr, size_t n)
+{
+	uint64_t sum = 0, x;
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		x = (uint32_t)arr[i] * 0x9e3779b97f4a7c15ULL;
+		sum += x ^ (x >> 29);
+	}
+	return sum;
+}
+
+/* Returns 1 if arr is in order and has the given fingerprint, 0 otherwise. */
+static int check(int32_t const *arr, size_t n, uint64_t expected)
+{
+	size_t i;
+
+	for (i = 1; i < n; ++i) {
+		if (arr[i] < arr[i - 1])
+			return 0;
+	}
+	return fingerprint(arr, n) == expected;
+}
+
+/*
+ * Opens the counters for this thread and any it starts.  The ones that
+ * can't be opened, say for lack of permission or hardware, are left at -1
+ * and come out as empty columns.
+ */
+static void open_counters(void)
+{
+	struct perf_event_attr attr;
+	int i;
+
+	for (i = 0; i < COUNTERS; ++i) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = counter_configs[i];
+		attr.disabled = 1;
+		attr.inherit = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		counter_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+			0);
+	}
+}
+
+/* Zeros and starts (on != 0) or stops (on == 0) every open counter. */
+static void switch_counters(int on)
+{
+	int i;
+
+	for (i = 0; i < COUNTERS; ++i) {
+		if (counter_fds[i] < 0)
+			continue;
+		if (on)
+			ioctl(counter_fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(counter_fds[i], on ? PERF_EVENT_IOC_ENABLE
+			: PERF_EVENT_IOC_DISABLE, 0);
+	}
+}
+
+/* Adds what every open counter counted to totals. */
+static void read_counters(uint64_t *totals)
+{
+	uint64_t value;
+	int i;
+
+	for (i = 0; i < COUNTERS; ++i) {
+		if (counter_fds[i] >= 0 &&
+			read(counter_fds[i], &value, sizeof(value)) ==
+			sizeof(value))
+			totals[i] += value;
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Times one sort on one input, sorting a fresh copy of it as many times as
+ * it takes to do about ELEMENTS_PER_RUN elements, and prints a CSV line.
+ * Only the sorting is timed and counted, not the copying.  Returns 1 if
+ * every output was right, 0 otherwise.
+ */
+static int run(struct Sort const *sort, char const *distribution,
+	int32_t const *input, int32_t *arr, size_t n, uint64_t expected)
+{
+	uint64_t totals[COUNTERS] = { 0 };
+	size_t work = ELEMENTS_PER_RUN / (sort->quadratic ? 100 : 1);
+	size_t reps = n < work ? work / n : 1;
+	size_t rep, elements;
+	double seconds = 0, start;
+	int valid = 1;
+	int i;
+
+	if (sort->quadratic && n > QUADRATIC_MAX)
+		return 1;
+
+	for (rep = 0; rep < reps; ++rep) {
+		memcpy(arr, input, sizeof(int32_t) * n);
+		switch_counters(1);
+		start = now();
+		sort->run(arr, n);
+		seconds += now() - start;
+		switch_counters(0);
+		read_counters(totals);
+		valid = valid && check(arr, n, expected);
+	}
+
+	elements = n * reps;
+	printf("%s,%s,%zu,%zu,%.3f", sort->name, distribution, n, reps,
+		seconds * 1e9 / elements);
+	for (i = 0; i < COUNTERS; ++i) {
+		if (counter_fds[i] >= 0)
+			printf(",%.3f", (double)totals[i] / elements);
+		else
+			printf(",");
+	}
+	printf(",%s\n", valid ? "ok" : "WRONG");
+	fflush(stdout);
+	return valid;
+}
+
+/*
+ * Runs the benchmark.  It takes two optional arguments: the largest size to
+ * run (default 1e7, sizes go up by powers of ten from 1e2) and the number of
+ * threads for the parallel sort (default one per online CPU).  The counters
+ * are per element and empty if they could not be read.
+ */
+int main(int argc, char **argv)
+{
+	size_t max_n = argc > 1 ? strtod(argv[1], NULL) : 1e7;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int32_t *input = malloc(sizeof(int32_t) * (max_n ? max_n : 1));
+	int32_t *arr = malloc(sizeof(int32_t) * (max_n ? max_n : 1));
+	uint64_t expected;
+	size_t n, i, d;
+	int ok = 1;
+
+	threads = argc > 2 ? strtoul(argv[2], NULL, 10) : cpus > 0 ? cpus : 1;
+	if (max_n < 100 || !threads) {
+		printf("Usage: bench [largest size] [threads]\n");
+		return 1;
+	}
+	if (!input || !arr) {
+		printf("Could not allocate %zu ints\n", max_n);
+		return 1;
+	}
+	open_counters();
+
+	/* Kept off stdout so the CSV stays clean. */
+	fprintf(stderr, "%s int32 kernels\n", sort_kernels());
+	printf("sort,distribution,n,reps,ns_per_element,cycles_per_element,"
+		"instructions_per_element,branch_misses_per_element,"
+		"cache_misses_per_element,valid\n");
+	for (n = 100; n <= max_n; n *= 10) {
+		for (d = 0; d < sizeof(distributions) / sizeof(char*); ++d) {
+			generate(input, n, d);
+			expected = fingerprint(input, n);
+			for (i = 0; i < sizeof(sorts) / sizeof(sorts[0]); ++i)
+				ok = run(&sorts[i], distributions[d], input,
+					arr, n, expected) && ok;
+		}
+	}
+
+	free(input);
+	free(arr);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+/******************************************************************************
+ *    FILE: Demo.c                                                            *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*************************************************************
+ * Just a simple Demonstration of every sort using an int[]  *
+ *************************************************************/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "sort.h"
+#define ARRAYSIZE sizeof(arr)/sizeof(arr[0])
+
+int compare(void const *a, void const *b)
+{
+	int32_t x = *(int32_t const*)a;
+	int32_t y = *(int32_t const*)b;
+
+	return (x > y) - (x < y);
+}
+
+/* The key prefix of an int32: its bits with the sign flipped. */
+uint64_t prefix(void const *a)
+{
+	return (uint32_t)*(int32_t const*)a ^ 0x80000000u;
+}
+
+void print(char const *name, int32_t *arr, unsigned size)
+{
+	unsigned i;
+
+	printf("%-20s", name);
+	for (i = 0; i < size; ++i)
+		printf("%d ", arr[i]);
+	printf("\n");
+}
+
+/*
+ * Sorts the file of int32s at in_path into out_path with external_sort_int32,
+ * using buffers of at most mb megabytes.
+ */
+int external(char const *in_path, char const *out_path, size_t mb)
+{
+	int in = open(in_path, O_RDONLY);
+	int out = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	int ok = in >= 0 && out >= 0 &&
+		external_sort_int32(in, out, mb << 20, NULL);
+
+	if (in >= 0)
+		close(in);
+	if (out >= 0 && close(out))
+		ok = 0;
+	if (!ok)
+		printf("Could not sort %s into %s\n", in_path, out_path);
+	return ok ? 0 : 1;
+}
+
+/*
+ * Given an input and an output file (and optionally a memory budget in MB,
+ * 64 by default) it sorts the int32s of the input with the external sort.
+ * Otherwise it shows every sort on a small array.
+ */
+int main(int argc, char **argv)
+{
+	int32_t const unsorted[10] = {10,9,8,7,6,5,4,3,2,1};
+	int32_t arr[10];
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (argc > 2)
+		return external(argv[1], argv[2],
+			argc > 3 ? strtoul(argv[3], NULL, 10) : 64);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	insertion_sort(arr, ARRAYSIZE, sizeof(arr[0]), compare);
+	print("insertion_sort", arr, ARRAYSIZE);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	selection_sort(arr, ARRAYSIZE, sizeof(arr[0]), compare);
+	print("selection_sort", arr, ARRAYSIZE);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	merge_sort(arr, ARRAYSIZE, sizeof(arr[0]), compare);
+	print("merge_sort", arr, ARRAYSIZE);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	tim_sort(arr, ARRAYSIZE, sizeof(arr[0]), compare);
+	print("tim_sort", arr, ARRAYSIZE);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	pdq_sort(arr, ARRAYSIZE, sizeof(arr[0]), compare);
+	print("pdq_sort", arr, ARRAYSIZE);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	heap_sort(arr, ARRAYSIZE, sizeof(arr[0]), compare);
+	print("heap_sort", arr, ARRAYSIZE);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	tag_sort(arr, ARRAYSIZE, sizeof(arr[0]), compare, prefix, NULL);
+	print("tag_sort", arr, ARRAYSIZE);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	partial_sort(arr, ARRAYSIZE, sizeof(arr[0]), compare, 3);
+	print("partial_sort(3)", arr, 3);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	select_nth(arr, ARRAYSIZE, sizeof(arr[0]), compare, ARRAYSIZE / 2);
+	print("select_nth(median)", arr + ARRAYSIZE / 2, 1);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	merge_sort_int32(arr, ARRAYSIZE);
+	print("merge_sort_int32", arr, ARRAYSIZE);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	radix_sort_int32(arr, ARRAYSIZE);
+	print("radix_sort_int32", arr, ARRAYSIZE);
+
+	memcpy(arr, unsorted, sizeof(arr));
+	parallel_merge_sort_int32(arr, ARRAYSIZE, cpus > 0 ? cpus : 1);
+	print("parallel_merge_sort", arr, ARRAYSIZE);
+
+	return 0;
+}
@@ -0,0 +1,522 @@
+/******************************************************************************
+ *    FILE: ExternalSort.c                                                    *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*************************************************************
+ * An External Merge Sort of int32s for files bigger than    *
+ * memory: sorted runs go to a temporary file and are then   *
+ * merged k at a time with a loser tree.  A helper thread    *
+ * does all of the reading and writing, so the I/O overlaps  *
+ * the sorting and merging.                                  *
+ *************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sort.h"
+
+/* Fewest ints moved by one read or write while merging. */
+#define MIN_BLOCK (1 << 14)
+
+/*
+ * A read or write for the I/O thread.  offset is where in the file it goes,
+ * or -1 to use the file position, which is how pipes are read and written.
+ * done is the number of bytes moved, short of size only at end of file.
+ */
+struct Job {
+	int fd;
+	int write;
+	off_t offset;
+	char *data;
+	size_t size;
+	size_t done;
+	int queued;
+	int failed;
+	struct Job *next;
+};
+
+/* The I/O thread and the jobs waiting for it. */
+struct Io {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	struct Job *head, *tail;
+	int stop;
+};
+
+/* A sorted run in a temporary file, offset in bytes and count in ints. */
+struct Run {
+	off_t offset;
+	size_t count;
+};
+
+/*
+ * A run being merged.  One buffer is merged from while the next block of
+ * the run is read into the other.
+ */
+struct Source {
+	int32_t *buffers[2];
+	struct Job jobs[2];
+	int current;
+	int32_t *data, *end;
+	off_t next;
+	size_t left;
+};
+
+/*
+ * Where the merge goes.  One buffer is filled while the other is written.
+ */
+struct Sink {
+	int32_t *buffers[2];
+	struct Job jobs[2];
+	int current;
+	int32_t *data, *end;
+	int fd;
+	off_t offset;
+};
+
+/* Moves all of a job's bytes, picking up after short and interrupted calls. */
+static void transfer(struct Job *job)
+{
+	ssize_t moved;
+
+	while (job->done < job->size) {
+		if (job->offset < 0)
+			moved = job->write
+				? write(job->fd, job->data + job->done,
+					job->size - job->done)
+				: read(job->fd, job->data + job->done,
+					job->size - job->done);
+		else
+			moved = job->write
+				? pwrite(job->fd, job->data + job->done,
+					job->size - job->done,
+					job->offset + job->done)
+				: pread(job->fd, job->data + job->done,
+					job->size - job->done,
+					job->offset + job->done);
+		if (moved < 0 && errno == EINTR)
+			continue;
+		if (moved < 0) {
+			job->failed = 1;
+			return;
+		}
+		if (moved == 0) {
+			job->failed = job->write;
+			return;
+		}
+		job->done += moved;
+	}
+}
+
+/* Runs jobs in the order they were handed in until told to stop. */
+static void *io_thread(void *arg)
+{
+	struct Io *io = arg;
+	struct Job *job;
+
+	pthread_mutex_lock(&io->lock);
+	for (;;) {
+		while (!io->head && !io->stop)
+			pthread_cond_wait(&io->wake, &io->lock);
+		if (!io->head)
+			break;
+		job = io->head;
+		if (!(io->head = job->next))
+			io->tail = NULL;
+		pthread_mutex_unlock(&io->lock);
+		transfer(job);
+		pthread_mutex_lock(&io->lock);
+		job->queued = 0;
+		pthread_cond_broadcast(&io->wake);
+	}
+	pthread_mutex_unlock(&io->lock);
+	return NULL;
+}
+
+/* Hands a read or write of size bytes at data to the I/O thread. */
+static void io_submit(struct Io *io, struct Job *job, int fd, int write,
+	off_t offset, void *data, size_t size)
+{
+	*job = (struct Job){ fd, write, offset, data, size, 0, 1, 0, NULL };
+	pthread_mutex_lock(&io->lock);
+	if (io->tail)
+		io->tail->next = job;
+	else
+		io->head = job;
+	io->tail = job;
+	pthread_cond_broadcast(&io->wake);
+	pthread_mutex_unlock(&io->lock);
+}
+
+/*
+ * Waits for a job to finish.  A job that was never submitted is finished.
+ * Returns 0 if it failed, 1 otherwise.
+ */
+static int io_wait(struct Io *io, struct Job *job)
+{
+	pthread_mutex_lock(&io->lock);
+	while (job->queued)
+		pthread_cond_wait(&io->wake, &io->lock);
+	pthread_mutex_unlock(&io->lock);
+	return !job->failed;
+}
+
+/* Opens an unnamed temporary file in dir, returns its fd or -1. */
+static int open_temp(char const *dir)
+{
+	size_t length = strlen(dir);
+	char *path = malloc(length + sizeof("/extsortXXXXXX"));
+	int fd;
+
+	if (!path)
+		return -1;
+	memcpy(path, dir, length);
+	memcpy(path + length, "/extsortXXXXXX", sizeof("/extsortXXXXXX"));
+	if ((fd = mkstemp(path)) >= 0)
+		unlink(path);
+	free(path);
+	return fd;
+}
+
+/*
+ * Reads in_fd run_n ints at a time, sorts every run and writes it to
+ * temp_fd.  The next run is read and the last one written while one is
+ * sorted.  An input that fits in a single run is written straight to out_fd
+ * instead, so *runs_n is left 0 when the output is already done.  Returns 0
+ * on failure, 1 otherwise.
+ */
+static int make_runs(struct Io *io, int in_fd, int out_fd, int temp_fd,
+	size_t run_n, struct Run **runs, size_t *runs_n)
+{
+	int32_t *buffers[2] = { malloc(sizeof(int32_t) * run_n),
+		malloc(sizeof(int32_t) * run_n) };
+	int32_t *scratch = malloc(sizeof(int32_t) * run_n);
+	struct Job reads[2] = {{ 0 }}, writes[2] = {{ 0 }};
+	struct Run *grown;
+	size_t capacity = 0, n;
+	off_t end = 0;
+	int current = 0, ok = 0;
+
+	*runs = NULL;
+	*runs_n = 0;
+	if (!buffers[0] || !buffers[1] || !scratch)
+		goto done;
+
+	io_submit(io, &reads[0], in_fd, 0, -1, buffers[0],
+		sizeof(int32_t) * run_n);
+	for (;; current = !current) {
+		if (!io_wait(io, &reads[current]) ||
+			reads[current].done % sizeof(int32_t))
+			goto done;
+		if (!(n = reads[current].done / sizeof(int32_t)))
+			break;
+
+		/* The other buffer is free once its run has been written. */
+		if (!io_wait(io, &writes[!current]))
+			goto done;
+		if (n == run_n)
+			io_submit(io, &reads[!current], in_fd, 0, -1,
+				buffers[!current], sizeof(int32_t) * run_n);
+		else
+			reads[!current] = (struct Job){ 0 };
+
+		merge_sort_int32_buffer(buffers[current], scratch, n);
+		if (n < run_n && !*runs_n) {
+			io_submit(io, &writes[current], out_fd, 1, -1,
+				buffers[current], sizeof(int32_t) * n);
+			ok = io_wait(io, &writes[current]);
+			goto done;
+		}
+
+		if (*runs_n == capacity) {
+			capacity = capacity * 2 + 16;
+			if (!(grown = realloc(*runs,
+				sizeof(struct Run) * capacity)))
+				goto done;
+			*runs = grown;
+		}
+		(*runs)[(*runs_n)++] = (struct Run){ end, n };
+		io_submit(io, &writes[current], temp_fd, 1, end,
+			buffers[current], sizeof(int32_t) * n);
+		end += sizeof(int32_t) * n;
+	}
+	ok = 1;
+
+done:
+	/* Nothing may still be using the buffers when they are freed. */
+	ok = io_wait(io, &reads[0]) & io_wait(io, &reads[1]) & ok;
+	ok = io_wait(io, &writes[0]) & io_wait(io, &writes[1]) & ok;
+	free(buffers[0]);
+	free(buffers[1]);
+	free(scratch);
+	return ok;
+}
+
+/* Asks for the next block of a run to be read into buffer which. */
+static void source_fill(struct Io *io, int fd, struct Source *src, int which,
+	size_t block)
+{
+	size_t n = src->left < block ? src->left : block;
+
+	if (!n) {
+		src->jobs[which] = (struct Job){ 0 };
+		return;
+	}
+	io_submit(io, &src->jobs[which], fd, 0, src->next,
+		src->buffers[which], sizeof(int32_t) * n);
+	src->next += sizeof(int32_t) * n;
+	src->left -= n;
+}
+
+/*
+ * Moves a run on to the block that was read ahead and starts reading the
+ * block after that.  The run is used up when data is still at end after
+ * this.  Returns 0 if a read failed, 1 otherwise.
+ */
+static int source_next(struct Io *io, int fd, struct Source *src,
+	size_t block)
+{
+	int next = !src->current;
+
+	if (!io_wait(io, &src->jobs[next]) ||
+		src->jobs[next].done != src->jobs[next].size)
+		return 0;
+	src->current = next;
+	src->data = src->buffers[next];
+	src->end = src->data + src->jobs[next].done / sizeof(int32_t);
+	source_fill(io, fd, src, !next, block);
+	return 1;
+}
+
+/* Hands the full buffer of the sink to be written and starts the other. */
+static int sink_flush(struct Io *io, struct Sink *sink, size_t block)
+{
+	size_t size = sizeof(int32_t) *
+		(sink->data - sink->buffers[sink->current]);
+
+	io_submit(io, &sink->jobs[sink->current], sink->fd, 1, sink->offset,
+		sink->buffers[sink->current], size);
+	if (sink->offset >= 0)
+		sink->offset += size;
+	sink->current = !sink->current;
+	sink->data = sink->buffers[sink->current];
+	sink->end = sink->data + block;
+	return io_wait(io, &sink->jobs[sink->current]);
+}
+
+/*
+ * True if run a comes out of the loser tree before run b.  Used up runs
+ * lose to everything, and equal heads go to the earlier run.
+ */
+static int beats(struct Source const *srcs, size_t a, size_t b)
+{
+	if (srcs[a].data == srcs[a].end)
+		return 0;
+	if (srcs[b].data == srcs[b].end)
+		return 1;
+	return *srcs[a].data < *srcs[b].data ||
+		(*srcs[a].data == *srcs[b].data && a < b);
+}
+
+/*
+ * Plays the games below node i of a loser tree of k runs, where nodes k to
+ * 2k - 1 are the runs themselves.  Every game leaves its loser in the node
+ * and the winner is returned.
+ */
+static size_t build_tree(size_t *tree, struct Source const *srcs, size_t k,
+	size_t i)
+{
+	size_t left, right;
+
+	if (i >= k)
+		return i - k;
+	left = build_tree(tree, srcs, k, 2 * i);
+	right = build_tree(tree, srcs, k, 2 * i + 1);
+	if (beats(srcs, left, right)) {
+		tree[i] = right;
+		return left;
+	}
+	tree[i] = left;
+	return right;
+}
+
+/*
+ * Merges k runs of in_fd into out_fd at out_offset (-1 for the file
+ * position), reading and writing block ints at a time.  tree[0] is always
+ * the run with the smallest head, and after it moves on only the games on
+ * its way up to the root are played again.  Returns 0 on failure, 1
+ * otherwise.
+ */
+static int merge_runs(struct Io *io, int in_fd, struct Run const *runs,
+	size_t k, int out_fd, off_t out_offset, size_t block)
+{
+	int32_t *memory = malloc(sizeof(int32_t) * block * (2 * k + 2));
+	struct Source *srcs = calloc(k, sizeof(struct Source));
+	size_t *tree = malloc(sizeof(size_t) * k);
+	struct Sink sink = {{ 0 }};
+	size_t i, winner, node, temp;
+	int ok = 0;
+
+	if (!memory || !srcs || !tree)
+		goto done;
+	for (i = 0; i < k; ++i) {
+		srcs[i].buffers[0] = memory + block * 2 * i;
+		srcs[i].buffers[1] = srcs[i].buffers[0] + block;
+		srcs[i].current = 1;
+		srcs[i].next = runs[i].offset;
+		srcs[i].left = runs[i].count;
+		source_fill(io, in_fd, &srcs[i], 0, block);
+	}
+	for (i = 0; i < k; ++i) {
+		if (!source_next(io, in_fd, &srcs[i], block))
+			goto done;
+	}
+	sink.buffers[0] = memory + block * 2 * k;
+	sink.buffers[1] = sink.buffers[0] + block;
+	sink.data = sink.buffers[0];
+	sink.end = sink.data + block;
+	sink.fd = out_fd;
+	sink.offset = out_offset;
+
+	tree[0] = build_tree(tree, srcs, k, 1);
+	for (winner = tree[0]; srcs[winner].data != srcs[winner].end;
+		winner = tree[0]) {
+		*sink.data++ = *srcs[winner].data++;
+		if (sink.data == sink.end && !sink_flush(io, &sink, block))
+			goto done;
+		if (srcs[winner].data == srcs[winner].end &&
+			!source_next(io, in_fd, &srcs[winner], block))
+			goto done;
+		for (node = (winner + k) / 2; node > 0; node /= 2) {
+			if (beats(srcs, tree[node], winner)) {
+				temp = tree[node];
+				tree[node] = winner;
+				winner = temp;
+			}
+		}
+		tree[0] = winner;
+	}
+	ok = sink_flush(io, &sink, block);
+
+done:
+	/* Nothing may still be using the buffers when they are freed. */
+	for (i = 0; srcs && i < k; ++i)
+		ok = io_wait(io, &srcs[i].jobs[0]) &
+			io_wait(io, &srcs[i].jobs[1]) & ok;
+	ok = io_wait(io, &sink.jobs[0]) & io_wait(io, &sink.jobs[1]) & ok;
+	free(memory);
+	free(srcs);
+	free(tree);
+	return ok;
+}
+
+/*
+ * Merges the runs fan_in at a time, writing the longer runs to the other
+ * temporary file, until they can all be merged into out_fd at once.
+ */
+static int merge_all(struct Io *io, int temp_fds[2], struct Run *runs,
+	size_t runs_n, int out_fd, size_t memory_n, size_t fan_in)
+{
+	size_t i, j, k, m, count;
+	off_t end;
+	int from = 0;
+
+	while (runs_n > fan_in) {
+		for (i = 0, j = 0, end = 0; i < runs_n; i += k, ++j) {
+			k = runs_n - i < fan_in ? runs_n - i : fan_in;
+			for (count = 0, m = 0; m < k; ++m)
+				count += runs[i + m].count;
+			if (!merge_runs(io, temp_fds[from], runs + i, k,
+				temp_fds[!from], end, memory_n / (2 * k + 2)))
+				return 0;
+			runs[j] = (struct Run){ end, count };
+			end += sizeof(int32_t) * count;
+		}
+		runs_n = j;
+		from = !from;
+	}
+	return merge_runs(io, temp_fds[from], runs, runs_n, out_fd, -1,
+		memory_n / (2 * runs_n + 2));
+}
+
+/*
+ * The memory budget is split three ways while making runs: the run being
+ * sorted, the scratch space of the sort and the next run being read.  While
+ * merging it is split into two blocks per run and two for the output, and
+ * runs are merged fan_in at a time so no block is smaller than MIN_BLOCK.
+ */
+int external_sort_int32(int in_fd, int out_fd, size_t memory,
+	char const *temp_dir)
+{
+	size_t memory_n, fan_in, runs_n = 0;
+	struct Run *runs = NULL;
+	int temp_fds[2] = { -1, -1 };
+	struct Io io = { 0 };
+	int ok = 0;
+
+	if (memory < EXTERNAL_MIN_MEMORY)
+		memory = EXTERNAL_MIN_MEMORY;
+	memory_n = memory / sizeof(int32_t);
+	fan_in = memory_n / (2 * MIN_BLOCK) - 1;
+	if (!temp_dir)
+		temp_dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+
+	if ((temp_fds[0] = open_temp(temp_dir)) < 0)
+		return 0;
+	pthread_mutex_init(&io.lock, NULL);
+	pthread_cond_init(&io.wake, NULL);
+	if (pthread_create(&io.thread, NULL, io_thread, &io)) {
+		close(temp_fds[0]);
+		return 0;
+	}
+
+	if (!make_runs(&io, in_fd, out_fd, temp_fds[0], memory_n / 3,
+		&runs, &runs_n))
+		goto done;
+	if (runs_n > fan_in && (temp_fds[1] = open_temp(temp_dir)) < 0)
+		goto done;
+	ok = !runs_n || merge_all(&io, temp_fds, runs, runs_n, out_fd,
+		memory_n, fan_in);
+
+done:
+	pthread_mutex_lock(&io.lock);
+	io.stop = 1;
+	pthread_cond_broadcast(&io.wake);
+	pthread_mutex_unlock(&io.lock);
+	pthread_join(io.thread, NULL);
+	pthread_mutex_destroy(&io.lock);
+	pthread_cond_destroy(&io.wake);
+	close(temp_fds[0]);
+	if (temp_fds[1] >= 0)
+		close(temp_fds[1]);
+	free(runs);
+	return ok;
+}
@@ -28,37 +28,51 @@
  ******************************************************************************/
 
 /*************************************************************
- * Just a simple Insertion Sort Demonstration using an int[] *
+ * Just a simple Insertion Sort, for any element type        *
  *************************************************************/
 
-#include <stdio.h>
-#define ARRAYSIZE sizeof(arr)/sizeof(arr[0])
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
 
-void sort(int *arr, unsigned size)
+/*
+ * Sorts the n elements of size bytes at base in the order of cmp.  Every
+ * element is held aside while the larger ones in front of it are moved up.
+ * Stable.
+ */
+void insertion_sort(void *base, size_t n, size_t size, SortCompareT cmp)
 {
-	unsigned i;
-	int j, key;
+	char *arr = base;
+	char small[64];
+	char *key = size <= sizeof(small) ? small : malloc(size);
+	size_t i, j;
 
-	for (i = 0; i < size; ++i) {
-		key = arr[i];
-		j = i - 1;
-		while (j >= -1 && key < arr[j]) {
-			arr[j+1] = arr[j];
-			--j;
+	if (!key) {
+		/* No room to hold the element aside, swap it down instead. */
+		for (i = 1; i < n; ++i) {
+			for (j = i; j > 0 && cmp(arr + j * size,
+				arr + (j - 1) * size) < 0; --j) {
+				size_t k;
+				for (k = 0; k < size; ++k) {
+					char temp = arr[j * size + k];
+					arr[j * size + k] = arr[(j - 1) * size + k];
+					arr[(j - 1) * size + k] = temp;
+				}
+			}
 		}
-		arr[j + 1] = key;
+		return;
 	}
-}
 
-int main(int argc, char **argv)
-{
-	unsigned i;
-	int arr[10] = {10,9,8,7,6,5,4,3,2,1};
-	sort(arr, ARRAYSIZE);
-	for (i = 0; i < ARRAYSIZE; ++i) {
-		printf("%d ", arr[i]);
+	for (i = 1; i < n; ++i) {
+		memcpy(key, arr + i * size, size);
+		for (j = i; j > 0 && cmp(key, arr + (j - 1) * size) < 0; --j)
+			;
+		if (j != i) {
+			memmove(arr + (j + 1) * size, arr + j * size, (i - j) * size);
+			memcpy(arr + j * size, key, size);
+		}
 	}
-	printf("\n");
 
- 	return 0;
-}
\ No newline at end of file
+	if (key != small)
+		free(key);
+}
@@ -28,73 +28,88 @@
  ******************************************************************************/
 
 /*************************************************************
- * Just a simple Merge Sort Demonstration using an int[]     *
+ * Just a simple Merge Sort, for any element type            *
  *************************************************************/
 
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "sort.h"
 
-void sort(int*, int*);
-void merge(int*, int*, int*);
-
-int main(void)
+/*
+ * Merges the sorted runs [l_iter, l_end) and [r_iter, r_end) of size byte
+ * elements into out.  Ties are taken from the left run to keep the sort
+ * stable.  If the two runs are already in order they are copied over without
+ * comparing.
+ */
+static void merge(char const *l_iter, char const *l_end, char const *r_iter,
+	char const *r_end, char *out, size_t size, SortCompareT cmp)
 {
-	unsigned i;
-	int arr[10] = {10,9,8,7,6,5,4,3,2,1};
-
-	sort(&arr[0], &arr[9]);
+	if (l_iter == l_end || r_iter == r_end || cmp(r_iter, l_end - size) >= 0) {
+		memcpy(out, l_iter, l_end - l_iter);
+		memcpy(out + (l_end - l_iter), r_iter, r_end - r_iter);
+		return;
+	}
 
-	for (i = 0; i < 10; ++i)
-		printf("%d ", arr[i]);
-	printf("\n");
+	while (l_iter < l_end && r_iter < r_end) {
+		if (cmp(r_iter, l_iter) < 0) {
+			memcpy(out, r_iter, size);
+			r_iter += size;
+		} else {
+			memcpy(out, l_iter, size);
+			l_iter += size;
+		}
+		out += size;
+	}
 
-	return 0;
+	memcpy(out, l_iter, l_end - l_iter);
+	memcpy(out + (l_end - l_iter), r_iter, r_end - r_iter);
 }
 
-void sort(int *begin, int *end)
+/*
+ * Sorts the n elements of size bytes at base in the order of cmp.  This is a
+ * bottom-up merge sort: runs of SORT_RUN_SIZE are insertion sorted in place,
+ * then merged in passes of doubling width.  Each pass merges from one buffer
+ * into the other, so the one auxiliary buffer of n elements is the only
+ * allocation made.  Stable.
+ *
+ * Returns 1, or 0 if the buffer could not be allocated.  The array is left as
+ * it was in that case.
+ */
+int merge_sort(void *base, size_t n, size_t size, SortCompareT cmp)
 {
-	if (begin < end) {
-		int *middle = (end - begin) / 2 + begin;
-		sort(begin, middle);
-		sort(middle + 1, end);
-		merge(begin, middle + 1, end);
-	}
-}
+	char *arr = base;
+	size_t width, i, middle, last;
+	char *from = arr;
+	char *to, *buffer, *temp;
 
-void merge(int *begin, int *middle, int *end)
-{
-	int *iter = begin;
-	unsigned l_size = middle - begin;
-	unsigned r_size = end - middle + 1;
-	int *l_arr = malloc(sizeof(int) * l_size);
-	int *l_iter = l_arr;
-	int *l_iter_e = l_arr + l_size;
-	int *r_arr = malloc(sizeof(int) * r_size);
-	int *r_iter = r_arr;
-	int *r_iter_e = r_arr + r_size;
-	
-	while (iter < middle) {
-		*l_iter++ = *iter++;
-	}
-	while (iter <= end) {
-		*r_iter++ = *iter++;
+	if (n <= SORT_RUN_SIZE) {
+		insertion_sort(arr, n, size, cmp);
+		return 1;
 	}
 
-	l_iter = l_arr;
-	r_iter = r_arr;
+	to = buffer = malloc(size * n);
+	if (!buffer)
+		return 0;
 
-	while (l_iter < l_iter_e && r_iter < r_iter_e) {
-		if (*l_iter < *r_iter)
-			*begin++ = *l_iter++;
-		else
-			*begin++ = *r_iter++;
-	}
+	for (i = 0; i < n; i += SORT_RUN_SIZE)
+		insertion_sort(arr + i * size,
+			i + SORT_RUN_SIZE < n ? SORT_RUN_SIZE : n - i, size, cmp);
 
-	while (l_iter < l_iter_e)
-		*begin++ = *l_iter++;
-	while (r_iter < r_iter_e)
-		*begin++ = *r_iter++;
+	for (width = SORT_RUN_SIZE; width < n; width *= 2) {
+		for (i = 0; i < n; i += 2 * width) {
+			middle = i + width < n ? i + width : n;
+			last = i + 2 * width < n ? i + 2 * width : n;
+			merge(from + i * size, from + middle * size,
+				from + middle * size, from + last * size,
+				to + i * size, size, cmp);
+		}
+		temp = from;
+		from = to;
+		to = temp;
+	}
 
-	free(l_arr);
-	free(r_arr);
-}
\ No newline at end of file
+	if (from != arr)
+		memcpy(arr, from, size * n);
+	free(buffer);
+	return 1;
+}
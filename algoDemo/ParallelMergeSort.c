@@ -0,0 +1,463 @@
+/******************************************************************************
+ *    FILE: ParallelMergeSort.c                                               *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*************************************************************
+ * A Merge Sort of int32s that runs on every core, using a   *
+ * work-stealing thread pool and parallel merges             *
+ *************************************************************/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+
+/* Ranges of this many ints or less are sorted by one thread. */
+#define SORT_CUTOFF (1 << 14)
+/* A parallel merge hands out this many output ints per task. */
+#define MERGE_GRAIN (1 << 15)
+
+struct Worker;
+
+/*
+ * A unit of work for the pool.  run is called with the task when it is
+ * picked up and again each time all of its children have finished, phase
+ * tells it which step it is at.  A sort task sorts the n ints at a, using
+ * the n ints at b as a buffer, and leaves the result in b if into_b is set.
+ * A merge task merges left[0, l_n) and right[0, r_n) into out.
+ */
+struct Task {
+	void (*run)(struct Worker*, struct Task*);
+	struct Task *parent;
+	atomic_size_t pending;
+	int phase;
+	int32_t *a, *b;
+	size_t n;
+	int into_b;
+	int32_t const *left, *right;
+	size_t l_n, r_n;
+	int32_t *out;
+};
+
+/* A worker's own tasks.  The owner works at tail, thieves take from head. */
+struct Deque {
+	pthread_mutex_t lock;
+	struct Task **tasks;
+	size_t head, tail, capacity;
+};
+
+struct Pool {
+	struct Deque *deques;
+	unsigned threads;
+	atomic_size_t queued;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	int done;
+};
+
+struct Worker {
+	struct Pool *pool;
+	unsigned id;
+	unsigned seed;
+	pthread_t thread;
+};
+
+static void sequential_sort(int32_t*, int32_t*, size_t, int);
+
+/* Orders int32s for pdq_sort, which sorts when there is no buffer. */
+static int compare_int32(void const *a, void const *b)
+{
+	int32_t x = *(int32_t const*)a;
+	int32_t y = *(int32_t const*)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Adds a task to the worker's own deque and wakes a sleeping worker. */
+static void push(struct Worker *self, struct Task *task)
+{
+	struct Pool *pool = self->pool;
+	struct Deque *deque = &pool->deques[self->id];
+	struct Task **tasks;
+
+	pthread_mutex_lock(&deque->lock);
+	if (deque->tail == deque->capacity && deque->head) {
+		memmove(deque->tasks, deque->tasks + deque->head,
+			sizeof(struct Task*) * (deque->tail - deque->head));
+		deque->tail -= deque->head;
+		deque->head = 0;
+	}
+	if (deque->tail == deque->capacity) {
+		tasks = realloc(deque->tasks,
+			sizeof(struct Task*) * (deque->capacity * 2 + 16));
+		if (!tasks) {
+			/* No room to queue it, so do it now instead. */
+			pthread_mutex_unlock(&deque->lock);
+			task->run(self, task);
+			return;
+		}
+		deque->tasks = tasks;
+		deque->capacity = deque->capacity * 2 + 16;
+	}
+	deque->tasks[deque->tail++] = task;
+	pthread_mutex_unlock(&deque->lock);
+
+	atomic_fetch_add(&pool->queued, 1);
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_signal(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Takes a task off of deque: the newest one if it is the worker's own, the
+ * oldest one (the biggest piece of work) if it is being stolen.
+ */
+static struct Task *take(struct Pool *pool, struct Deque *deque, int own)
+{
+	struct Task *task = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+	if (deque->head < deque->tail) {
+		task = own ? deque->tasks[--deque->tail]
+			: deque->tasks[deque->head++];
+		atomic_fetch_sub(&pool->queued, 1);
+	}
+	pthread_mutex_unlock(&deque->lock);
+	return task;
+}
+
+/*
+ * Finds the next task for a worker: its own newest task, or else one stolen
+ * from another worker, starting at a random one.  Sleeps while there is
+ * nothing to do and returns NULL once the sort is done.
+ */
+static struct Task *next_task(struct Worker *self)
+{
+	struct Pool *pool = self->pool;
+	struct Task *task;
+	unsigned i, victim;
+
+	for (;;) {
+		if ((task = take(pool, &pool->deques[self->id], 1)))
+			return task;
+		self->seed = self->seed * 1103515245 + 12345;
+		victim = self->seed >> 16;
+		for (i = 0; i < pool->threads; ++i) {
+			if ((task = take(pool,
+				&pool->deques[(victim + i) % pool->threads], 0)))
+				return task;
+		}
+		pthread_mutex_lock(&pool->lock);
+		while (!atomic_load(&pool->queued) && !pool->done)
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		if (pool->done) {
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+/* Runs tasks until the sort is done. */
+static void *work(void *arg)
+{
+	struct Worker *self = arg;
+	struct Task *task;
+
+	while ((task = next_task(self)))
+		task->run(self, task);
+	return NULL;
+}
+
+/*
+ * Frees a finished task and tells its parent.  The child that finishes last
+ * runs the parent's next step, so nothing ever blocks waiting on a child.
+ */
+static void finish(struct Worker *self, struct Task *task)
+{
+	struct Task *parent = task->parent;
+	struct Pool *pool = self->pool;
+
+	free(task);
+	if (!parent) {
+		pthread_mutex_lock(&pool->lock);
+		pool->done = 1;
+		pthread_cond_broadcast(&pool->wake);
+		pthread_mutex_unlock(&pool->lock);
+		return;
+	}
+	if (atomic_fetch_sub(&parent->pending, 1) == 1)
+		parent->run(self, parent);
+}
+
+/* Runs a merge task. */
+static void run_merge(struct Worker *self, struct Task *task)
+{
+	merge_int32(task->left, task->l_n, task->right, task->r_n, task->out);
+	finish(self, task);
+}
+
+/*
+ * Returns how many of the first k ints of the merge of left[0, l_n) and
+ * right[0, r_n) come from left.  Ties go to left, so the pieces of a split
+ * merge fit together exactly.
+ */
+static size_t co_rank(size_t k, int32_t const *left, size_t l_n,
+	int32_t const *right, size_t r_n)
+{
+	size_t lo = k > r_n ? k - r_n : 0;
+	size_t hi = k < l_n ? k : l_n;
+	size_t i;
+
+	while (lo < hi) {
+		i = lo + (hi - lo) / 2;
+		if (left[i] > right[k - i - 1])
+			hi = i;
+		else
+			lo = i + 1;
+	}
+	return lo;
+}
+
+/*
+ * Merges from[0, half) and from[half, n) into to as children of parent.
+ * The output is cut into MERGE_GRAIN pieces and co_rank finds where every
+ * piece starts in each run, so the pieces are merged in parallel.
+ */
+static void spawn_merges(struct Worker *self, struct Task *parent,
+	int32_t const *from, size_t half, size_t n, int32_t *to)
+{
+	size_t pieces = (n + MERGE_GRAIN - 1) / MERGE_GRAIN;
+	size_t p, k, i, next_k, next_i;
+	struct Task **tasks = malloc(sizeof(struct Task*) * pieces);
+	struct Task *first;
+
+	for (p = 0; tasks && p < pieces; ++p) {
+		if (!(tasks[p] = malloc(sizeof(struct Task)))) {
+			while (p--)
+				free(tasks[p]);
+			free(tasks);
+			tasks = NULL;
+		}
+	}
+	if (!tasks) {
+		/* Out of memory, merge it all right here. */
+		merge_int32(from, half, from + half, n - half, to);
+		parent->run(self, parent);
+		return;
+	}
+
+	atomic_store(&parent->pending, pieces);
+	for (p = 0, k = 0, i = 0; p < pieces; ++p, k = next_k, i = next_i) {
+		next_k = n * (p + 1) / pieces;
+		next_i = co_rank(next_k, from, half, from + half, n - half);
+		tasks[p]->run = run_merge;
+		tasks[p]->parent = parent;
+		tasks[p]->left = from + i;
+		tasks[p]->l_n = next_i - i;
+		tasks[p]->right = from + half + (k - i);
+		tasks[p]->r_n = (next_k - next_i) - (k - i);
+		tasks[p]->out = to + k;
+	}
+	first = tasks[0];
+	for (p = pieces - 1; p > 0; --p)
+		push(self, tasks[p]);
+	free(tasks);
+	run_merge(self, first);
+}
+
+/*
+ * Runs a sort task.  Phase 0 sorts a small range on the spot or splits it
+ * into two sort tasks that leave their halves in the other buffer.  Phase 1
+ * runs once both halves are sorted and merges them back in parallel.  Phase 2
+ * runs once the merge is done.
+ */
+static void run_sort(struct Worker *self, struct Task *task)
+{
+	size_t half = task->n / 2;
+	struct Task *left, *right;
+
+	switch (task->phase) {
+	case 0:
+		if (task->n > SORT_CUTOFF) {
+			left = malloc(sizeof(struct Task));
+			right = malloc(sizeof(struct Task));
+			if (left && right) {
+				*left = (struct Task) { run_sort, task };
+				left->a = task->a;
+				left->b = task->b;
+				left->n = half;
+				left->into_b = !task->into_b;
+				*right = *left;
+				right->a += half;
+				right->b += half;
+				right->n = task->n - half;
+				atomic_init(&left->pending, 0);
+				atomic_init(&right->pending, 0);
+
+				task->phase = 1;
+				atomic_store(&task->pending, 2);
+				push(self, right);
+				run_sort(self, left);
+				return;
+			}
+			free(left);
+			free(right);
+		}
+		sequential_sort(task->a, task->b, task->n, task->into_b);
+		finish(self, task);
+		return;
+	case 1:
+		task->phase = 2;
+		if (task->into_b)
+			spawn_merges(self, task, task->a, half, task->n, task->b);
+		else
+			spawn_merges(self, task, task->b, half, task->n, task->a);
+		return;
+	default:
+		finish(self, task);
+	}
+}
+
+/*
+ * Sorts the n int32s at arr on up to threads threads.  The calling thread
+ * works too.  Ranges are split in half until they are SORT_CUTOFF ints or
+ * less, the halves are sorted as tasks that idle threads steal from each
+ * other, and the merges are split up too so the last ones, which cover the
+ * whole array, don't leave all but one thread idle.  Without memory for the
+ * buffer it falls back to pdq_sort on the calling thread.
+ */
+void parallel_merge_sort_int32(int32_t *arr, size_t n, unsigned threads)
+{
+	struct Pool pool;
+	struct Worker *workers;
+	struct Task *root;
+	int32_t *buffer;
+	unsigned i;
+
+	if (n < 2)
+		return;
+	buffer = malloc(sizeof(int32_t) * n);
+	if (!buffer) {
+		/*
+		 * Out of memory, still sort but in place.  Equal ints can't
+		 * be told apart, so pdq_sort not being stable doesn't matter.
+		 */
+		pdq_sort(arr, n, sizeof(int32_t), compare_int32);
+		return;
+	}
+	if (threads < 2 || n <= SORT_CUTOFF) {
+		sequential_sort(arr, buffer, n, 0);
+		free(buffer);
+		return;
+	}
+
+	workers = calloc(threads, sizeof(struct Worker));
+	pool.deques = calloc(threads, sizeof(struct Deque));
+	root = malloc(sizeof(struct Task));
+	if (!workers || !pool.deques || !root) {
+		sequential_sort(arr, buffer, n, 0);
+		free(workers);
+		free(pool.deques);
+		free(root);
+		free(buffer);
+		return;
+	}
+
+	pool.threads = threads;
+	pool.done = 0;
+	atomic_init(&pool.queued, 0);
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.wake, NULL);
+	for (i = 0; i < threads; ++i) {
+		pthread_mutex_init(&pool.deques[i].lock, NULL);
+		workers[i] = (struct Worker) { &pool, i, i + 1 };
+	}
+
+	*root = (struct Task) { run_sort, NULL };
+	root->a = arr;
+	root->b = buffer;
+	root->n = n;
+	atomic_init(&root->pending, 0);
+	push(&workers[0], root);
+
+	/* Threads that won't start just leave more work for the others. */
+	for (i = 1; i < threads; ++i) {
+		if (pthread_create(&workers[i].thread, NULL, work, &workers[i]))
+			workers[i].pool = NULL;
+	}
+	work(&workers[0]);
+	for (i = 1; i < threads; ++i) {
+		if (workers[i].pool)
+			pthread_join(workers[i].thread, NULL);
+	}
+
+	for (i = 0; i < threads; ++i) {
+		pthread_mutex_destroy(&pool.deques[i].lock);
+		free(pool.deques[i].tasks);
+	}
+	pthread_mutex_destroy(&pool.lock);
+	pthread_cond_destroy(&pool.wake);
+	free(pool.deques);
+	free(workers);
+	free(buffer);
+}
+
+/*
+ * Sorts the n ints at a on one thread, using the n ints at b as a buffer,
+ * and leaves the result in b if into_b is set or else in a.  Blocks of
+ * SORT_BLOCK_SIZE are sorted by sort_block_int32, then merged bottom-up from
+ * one buffer into the other by merge_int32.
+ */
+static void sequential_sort(int32_t *a, int32_t *b, size_t n, int into_b)
+{
+	size_t width, i, middle, last;
+	int32_t *from = a;
+	int32_t *to = b;
+	int32_t *temp;
+
+	for (i = 0; i < n; i += SORT_BLOCK_SIZE)
+		sort_block_int32(a + i,
+			i + SORT_BLOCK_SIZE < n ? SORT_BLOCK_SIZE : n - i);
+
+	for (width = SORT_BLOCK_SIZE; width < n; width *= 2) {
+		for (i = 0; i < n; i += 2 * width) {
+			middle = i + width < n ? i + width : n;
+			last = i + 2 * width < n ? i + 2 * width : n;
+			merge_int32(from + i, middle - i, from + middle,
+				last - middle, to + i);
+		}
+		temp = from;
+		from = to;
+		to = temp;
+	}
+
+	if (from != (into_b ? b : a))
+		memcpy(into_b ? b : a, from, sizeof(int32_t) * n);
+}
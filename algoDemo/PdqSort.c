@@ -0,0 +1,337 @@
+/******************************************************************************
+ *    FILE: PdqSort.c                                                         *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*************************************************************
+ * A Pattern-Defeating Quicksort, in place and for any       *
+ * element type.  O(n log n) at worst with no allocation.    *
+ *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+
+/* Ranges this small are insertion sorted. */
+#define INSERTION_CUTOFF 24
+
+/* Ranges bigger than this take the ninther as their pivot. */
+#define NINTHER_CUTOFF 128
+
+/* partial_insertion_sort gives up after moving this many elements. */
+#define PARTIAL_LIMIT 8
+
+/* Elements looked at per block of a block partition. */
+#define BLOCK 64
+
+/* Address of element i of base. */
+#define AT(i) (base + (size_t)(i) * s->size)
+
+/*
+ * The state of one sort.  key is room to hold an element aside, or NULL for
+ * elements too big for it, which are then moved by swapping.
+ */
+struct State {
+	size_t size;
+	SortCompareT cmp;
+	char *key;
+};
+
+/* Swaps the size bytes at a and b, a chunk at a time. */
+static void swap(char *a, char *b, size_t size)
+{
+	char temp[64];
+	size_t chunk;
+
+	for (; size; size -= chunk, a += chunk, b += chunk) {
+		chunk = size < sizeof(temp) ? size : sizeof(temp);
+		memcpy(temp, a, chunk);
+		memcpy(a, b, chunk);
+		memcpy(b, temp, chunk);
+	}
+}
+
+/* Moves element i of base down to j < i, moving the ones between up. */
+static void move_down(struct State *s, char *base, size_t i, size_t j)
+{
+	if (!s->key) {
+		for (; i > j; --i)
+			swap(AT(i), AT(i - 1), s->size);
+		return;
+	}
+	memcpy(s->key, AT(i), s->size);
+	memmove(AT(j + 1), AT(j), (i - j) * s->size);
+	memcpy(AT(j), s->key, s->size);
+}
+
+/* Sorts the n elements at base by insertion. */
+static void insertion(struct State *s, char *base, size_t n)
+{
+	size_t i, j;
+
+	for (i = 1; i < n; ++i) {
+		for (j = i; j > 0 && s->cmp(AT(i), AT(j - 1)) < 0; --j)
+			;
+		if (j != i)
+			move_down(s, base, i, j);
+	}
+}
+
+/*
+ * Insertion sorts the n elements at base, but gives up once more than
+ * PARTIAL_LIMIT elements have had to move.  Returns 1 if they got sorted.
+ */
+static int partial_insertion_sort(struct State *s, char *base, size_t n)
+{
+	size_t i, j, moved = 0;
+
+	for (i = 1; i < n; ++i) {
+		for (j = i; j > 0 && s->cmp(AT(i), AT(j - 1)) < 0; --j)
+			;
+		if (j != i) {
+			move_down(s, base, i, j);
+			moved += i - j;
+			if (moved > PARTIAL_LIMIT)
+				return 0;
+		}
+	}
+	return 1;
+}
+
+/* Puts elements i, j and k of base in order. */
+static void sort3(struct State *s, char *base, size_t i, size_t j, size_t k)
+{
+	if (s->cmp(AT(j), AT(i)) < 0)
+		swap(AT(i), AT(j), s->size);
+	if (s->cmp(AT(k), AT(j)) < 0)
+		swap(AT(j), AT(k), s->size);
+	if (s->cmp(AT(j), AT(i)) < 0)
+		swap(AT(i), AT(j), s->size);
+}
+
+/*
+ * Partitions the n elements at base around the pivot at base, putting the
+ * ones less than it on the left and the rest on the right, and the pivot
+ * between them.  Sets *swapped if anything had to move.  Returns where the
+ * pivot ends up.
+ *
+ * Most of the range goes through in blocks: the offsets of the elements on
+ * the wrong side are written down for a block from each end, counting with
+ * the result of each comparison instead of branching on it, and then the
+ * pairs are swapped.  Whatever is left when the ends meet is done one at a
+ * time.
+ */
+static size_t partition_right(struct State *s, char *base, size_t n,
+	int *swapped)
+{
+	unsigned char offsets_l[BLOCK], offsets_r[BLOCK];
+	size_t l = 1, r = n;
+	size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0, num, i;
+
+	*swapped = 0;
+	while (r - l >= 2 * BLOCK) {
+		if (!num_l) {
+			start_l = 0;
+			for (i = 0; i < BLOCK; ++i) {
+				offsets_l[num_l] = i;
+				num_l += s->cmp(AT(l + i), base) >= 0;
+			}
+		}
+		if (!num_r) {
+			start_r = 0;
+			for (i = 0; i < BLOCK; ++i) {
+				offsets_r[num_r] = i;
+				num_r += s->cmp(AT(r - 1 - i), base) < 0;
+			}
+		}
+		num = num_l < num_r ? num_l : num_r;
+		for (i = 0; i < num; ++i)
+			swap(AT(l + offsets_l[start_l + i]),
+				AT(r - 1 - offsets_r[start_r + i]), s->size);
+		*swapped |= num > 0;
+		num_l -= num;
+		num_r -= num;
+		start_l += num;
+		start_r += num;
+		if (!num_l)
+			l += BLOCK;
+		if (!num_r)
+			r -= BLOCK;
+	}
+
+	/* What's left, including any half-done block, one at a time. */
+	for (;;) {
+		while (l < r && s->cmp(AT(l), base) < 0)
+			++l;
+		while (l < r && s->cmp(AT(r - 1), base) >= 0)
+			--r;
+		if (l >= r)
+			break;
+		swap(AT(l), AT(r - 1), s->size);
+		*swapped = 1;
+		++l;
+		--r;
+	}
+	if (l > 1)
+		swap(base, AT(l - 1), s->size);
+	return l - 1;
+}
+
+/*
+ * Partitions like partition_right, but with the elements equal to the pivot
+ * on the left.  It is used when the pivot equals an element known to be no
+ * bigger than anything in the range, so everything that goes left is equal
+ * to it and is done.
+ */
+static size_t partition_left(struct State *s, char *base, size_t n)
+{
+	size_t l = 1, r = n;
+
+	for (;;) {
+		while (l < r && s->cmp(base, AT(l)) >= 0)
+			++l;
+		while (l < r && s->cmp(base, AT(r - 1)) < 0)
+			--r;
+		if (l >= r)
+			break;
+		swap(AT(l), AT(r - 1), s->size);
+		++l;
+		--r;
+	}
+	if (l > 1)
+		swap(base, AT(l - 1), s->size);
+	return l - 1;
+}
+
+/*
+ * Sorts the n elements at base.  bad is how many more badly unbalanced
+ * partitions are tolerated before the range is heap sorted instead.
+ * leftmost is set if nothing comes before base in the array, otherwise the
+ * element before it is no bigger than anything in the range.  Recurses on
+ * the left part and loops on the right one.
+ */
+static void pdq(struct State *s, char *base, size_t n, unsigned bad,
+	int leftmost)
+{
+	size_t half, p, l_n, r_n, q;
+	int swapped;
+
+	for (;;) {
+		if (n < INSERTION_CUTOFF) {
+			insertion(s, base, n);
+			return;
+		}
+
+		/* Pivot: median of 3, or the ninther, moved to the front. */
+		half = n / 2;
+		if (n > NINTHER_CUTOFF) {
+			sort3(s, base, 0, half, n - 1);
+			sort3(s, base, 1, half - 1, n - 2);
+			sort3(s, base, 2, half + 1, n - 3);
+			sort3(s, base, half - 1, half, half + 1);
+			swap(base, AT(half), s->size);
+		} else {
+			sort3(s, base, half, 0, n - 1);
+		}
+
+		/*
+		 * A pivot equal to the element before the range is its
+		 * smallest value: split off all the copies of it in one go.
+		 */
+		if (!leftmost && s->cmp(base - s->size, base) >= 0) {
+			p = partition_left(s, base, n);
+			base = AT(p + 1);
+			n -= p + 1;
+			continue;
+		}
+
+		p = partition_right(s, base, n, &swapped);
+		l_n = p;
+		r_n = n - p - 1;
+
+		if (l_n < n / 8 || r_n < n / 8) {
+			/* Badly unbalanced, shuffle some elements around. */
+			if (!--bad) {
+				heap_sort(base, n, s->size, s->cmp);
+				return;
+			}
+			if (l_n >= INSERTION_CUTOFF) {
+				q = l_n / 4;
+				swap(base, AT(q), s->size);
+				swap(AT(p - 1), AT(p - q), s->size);
+				if (l_n > NINTHER_CUTOFF) {
+					swap(AT(1), AT(q + 1), s->size);
+					swap(AT(2), AT(q + 2), s->size);
+					swap(AT(p - 2), AT(p - q - 1), s->size);
+					swap(AT(p - 3), AT(p - q - 2), s->size);
+				}
+			}
+			if (r_n >= INSERTION_CUTOFF) {
+				q = r_n / 4;
+				swap(AT(p + 1), AT(p + 1 + q), s->size);
+				swap(AT(n - 1), AT(n - q), s->size);
+				if (r_n > NINTHER_CUTOFF) {
+					swap(AT(p + 2), AT(p + 2 + q), s->size);
+					swap(AT(p + 3), AT(p + 3 + q), s->size);
+					swap(AT(n - 2), AT(n - q - 1), s->size);
+					swap(AT(n - 3), AT(n - q - 2), s->size);
+				}
+			}
+		} else if (!swapped && partial_insertion_sort(s, base, l_n) &&
+			partial_insertion_sort(s, AT(p + 1), r_n)) {
+			/* It was already partitioned and both sides were sorted. */
+			return;
+		}
+
+		pdq(s, base, l_n, bad, leftmost);
+		base = AT(p + 1);
+		n = r_n;
+		leftmost = 0;
+	}
+}
+
+/*
+ * Sorts the n elements of size bytes at base in the order of cmp, in place.
+ * This is a quicksort with pdqsort's defenses: ninther pivots, branchless
+ * block partitioning, a fast path for runs of equal elements, shuffling
+ * when a partition comes out badly unbalanced and a switch to heap sort if
+ * that keeps happening, so it is O(n log n) at worst.  Partitions that find
+ * their range already in order try to finish it with a bounded insertion
+ * sort, which makes sorted input O(n).  Nothing is allocated.  Not stable.
+ */
+void pdq_sort(void *base, size_t n, size_t size, SortCompareT cmp)
+{
+	char small[64];
+	struct State state = { size, cmp, size <= sizeof(small) ? small : NULL };
+	unsigned bad = 1;
+	size_t m;
+
+	/* Allow about log2(n) bad partitions. */
+	for (m = n; m > 1; m /= 2)
+		++bad;
+	pdq(&state, base, n, bad, 1);
+}
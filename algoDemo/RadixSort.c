@@ -0,0 +1,187 @@
+/******************************************************************************
+ *    FILE: RadixSort.c                                                       *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*************************************************************
+ * An LSD Radix Sort for integer and floating point keys,    *
+ * with or without a payload riding along with every key     *
+ *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+
+/* Bits of the key sorted on per pass. */
+#define DIGIT_BITS 8
+#define DIGIT_VALUES (1 << DIGIT_BITS)
+#define DIGIT_MASK (DIGIT_VALUES - 1)
+
+/*
+ * These turn a key into an unsigned integer that orders the same way.  Signed
+ * ints get their sign bit flipped.  Negative floats get every bit flipped so
+ * bigger magnitudes come first, positive ones just the sign bit.
+ */
+static inline uint32_t key_uint32(uint32_t x) { return x; }
+static inline uint64_t key_uint64(uint64_t x) { return x; }
+static inline uint32_t key_int32(int32_t x) { return (uint32_t)x ^ 0x80000000u; }
+static inline uint64_t key_int64(int64_t x)
+{
+	return (uint64_t)x ^ 0x8000000000000000ull;
+}
+
+static inline uint32_t key_float(float x)
+{
+	uint32_t u;
+
+	memcpy(&u, &x, sizeof(u));
+	return u ^ (-(u >> 31) | 0x80000000u);
+}
+
+static inline uint64_t key_double(double x)
+{
+	uint64_t u;
+
+	memcpy(&u, &x, sizeof(u));
+	return u ^ (-(u >> 63) | 0x8000000000000000ull);
+}
+
+/*
+ * Copies one payload of size bytes.  The common sizes get a plain load and
+ * store instead of a call to memcpy.
+ */
+static inline void copy_payload(char *to, char const *from, size_t size)
+{
+	switch (size) {
+	case sizeof(uint32_t):
+		memcpy(to, from, sizeof(uint32_t));
+		break;
+	case sizeof(uint64_t):
+		memcpy(to, from, sizeof(uint64_t));
+		break;
+	default:
+		memcpy(to, from, size);
+	}
+}
+
+/*
+ * RADIX_DEFINE defines radix_sort_name and radix_sort_name_payload for keys
+ * of type, which key() turns into the unsigned utype.
+ *
+ * One pass over the keys counts every digit of every key.  Then there is one
+ * scatter pass per digit, from the least significant up, between the array
+ * and a buffer.  A digit that is the same in every key would not move
+ * anything, so its pass is skipped.
+ */
+#define RADIX_DEFINE(name, type, utype, key)                                 \
+int radix_sort_##name##_payload(type *keys, void *payload, size_t size,     \
+	size_t n)                                                            \
+{                                                                            \
+	enum { DIGITS = sizeof(utype) * 8 / DIGIT_BITS };                    \
+	size_t counts[DIGITS][DIGIT_VALUES];                                 \
+	size_t offsets[DIGIT_VALUES];                                        \
+	type *from = keys;                                                   \
+	type *to;                                                            \
+	type *temp;                                                          \
+	char *p_from = payload;                                              \
+	char *p_to = NULL;                                                   \
+	char *p_temp;                                                        \
+	size_t i, sum, d;                                                    \
+	unsigned shift;                                                      \
+	utype k;                                                             \
+                                                                             \
+	if (n < 2)                                                           \
+		return 1;                                                    \
+	to = malloc(sizeof(type) * n);                                       \
+	if (payload)                                                         \
+		p_to = malloc(size * n);                                     \
+	if (!to || (payload && !p_to)) {                                     \
+		free(to);                                                    \
+		free(p_to);                                                  \
+		return 0;                                                    \
+	}                                                                    \
+                                                                             \
+	memset(counts, 0, sizeof(counts));                                   \
+	for (i = 0; i < n; ++i) {                                            \
+		k = key(keys[i]);                                            \
+		for (d = 0; d < DIGITS; ++d)                                 \
+			++counts[d][(k >> (d * DIGIT_BITS)) & DIGIT_MASK];   \
+	}                                                                    \
+                                                                             \
+	for (d = 0; d < DIGITS; ++d) {                                       \
+		shift = d * DIGIT_BITS;                                      \
+		if (counts[d][(key(keys[0]) >> shift) & DIGIT_MASK] == n)    \
+			continue;                                            \
+		for (i = 0, sum = 0; i < DIGIT_VALUES; ++i) {                \
+			offsets[i] = sum;                                    \
+			sum += counts[d][i];                                 \
+		}                                                            \
+		if (payload) {                                               \
+			for (i = 0; i < n; ++i) {                            \
+				size_t j = offsets[(key(from[i]) >> shift)   \
+					& DIGIT_MASK]++;                     \
+				to[j] = from[i];                             \
+				copy_payload(p_to + j * size,                \
+					p_from + i * size, size);            \
+			}                                                    \
+			p_temp = p_from;                                     \
+			p_from = p_to;                                       \
+			p_to = p_temp;                                       \
+		} else {                                                     \
+			for (i = 0; i < n; ++i)                              \
+				to[offsets[(key(from[i]) >> shift)           \
+					& DIGIT_MASK]++] = from[i];          \
+		}                                                            \
+		temp = from;                                                 \
+		from = to;                                                   \
+		to = temp;                                                   \
+	}                                                                    \
+                                                                             \
+	if (from != keys) {                                                  \
+		memcpy(keys, from, sizeof(type) * n);                        \
+		if (payload)                                                 \
+			memcpy(payload, p_from, size * n);                   \
+		free(from);                                                  \
+		free(p_from);                                                \
+	} else {                                                             \
+		free(to);                                                    \
+		free(p_to);                                                  \
+	}                                                                    \
+	return 1;                                                            \
+}                                                                            \
+                                                                             \
+int radix_sort_##name(type *keys, size_t n)                                  \
+{                                                                            \
+	return radix_sort_##name##_payload(keys, NULL, 0, n);                \
+}
+
+RADIX_DEFINE(uint32, uint32_t, uint32_t, key_uint32)
+RADIX_DEFINE(int32, int32_t, uint32_t, key_int32)
+RADIX_DEFINE(float, float, uint32_t, key_float)
+RADIX_DEFINE(uint64, uint64_t, uint64_t, key_uint64)
+RADIX_DEFINE(int64, int64_t, uint64_t, key_int64)
+RADIX_DEFINE(double, double, uint64_t, key_double)
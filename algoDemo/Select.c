@@ -0,0 +1,240 @@
+/******************************************************************************
+ *    FILE: Select.c                                                          *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*************************************************************
+ * Selection of the nth smallest element and partial sorts   *
+ * of the k smallest, for any element type                   *
+ *************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+
+/* Ranges bigger than this pick their pivot range from a sample. */
+#define SAMPLE_CUTOFF 600
+
+/* Address of element i of base. */
+#define AT(i) (base + (size_t)(i) * size)
+
+/* Swaps the size bytes at a and b, a chunk at a time. */
+static void swap(char *a, char *b, size_t size)
+{
+	char temp[64];
+	size_t chunk;
+
+	for (; size; size -= chunk, a += chunk, b += chunk) {
+		chunk = size < sizeof(temp) ? size : sizeof(temp);
+		memcpy(temp, a, chunk);
+		memcpy(a, b, chunk);
+		memcpy(b, temp, chunk);
+	}
+}
+
+/* Restores the max-heap of the n elements at base below element i. */
+static void sift_down(char *base, size_t i, size_t n, size_t size,
+	SortCompareT cmp)
+{
+	size_t child;
+
+	for (; (child = 2 * i + 1) < n; i = child) {
+		if (child + 1 < n && cmp(AT(child), AT(child + 1)) < 0)
+			++child;
+		if (cmp(AT(i), AT(child)) >= 0)
+			break;
+		swap(AT(i), AT(child), size);
+	}
+}
+
+/*
+ * Moves the k smallest of the n elements at base to the front, in a max-heap
+ * so the biggest of them is first.  The rest are only looked at once, each
+ * against the top of the heap, so it takes O(n log k).
+ */
+static void heap_select(char *base, size_t n, size_t k, size_t size,
+	SortCompareT cmp)
+{
+	size_t i;
+
+	for (i = k / 2; i-- > 0; )
+		sift_down(base, i, k, size, cmp);
+	for (i = k; i < n; ++i) {
+		if (cmp(AT(i), AT(0)) < 0) {
+			swap(AT(i), AT(0), size);
+			sift_down(base, 0, k, size, cmp);
+		}
+	}
+}
+
+/* Sorts the max-heap of n elements at base. */
+static void sort_heap(char *base, size_t n, size_t size, SortCompareT cmp)
+{
+	for (; n > 1; --n) {
+		swap(AT(0), AT(n - 1), size);
+		sift_down(base, 0, n - 1, size, cmp);
+	}
+}
+
+/*
+ * Sorts the n elements of size bytes at base in the order of cmp by making
+ * them a max-heap and taking the biggest off the top until it is empty.
+ * O(n log n) at worst, in place.  Not stable.
+ */
+void heap_sort(void *base_, size_t n, size_t size, SortCompareT cmp)
+{
+	char *base = base_;
+	size_t i;
+
+	for (i = n / 2; i-- > 0; )
+		sift_down(base, i, n, size, cmp);
+	sort_heap(base, n, size, cmp);
+}
+
+/*
+ * The Floyd-Rivest selection of element k of [left, right].  Big ranges
+ * first select recursively on a sample around where k is expected to fall,
+ * so the pivot lands close to k and each partition throws away most of the
+ * range.  key holds the pivot while it is partitioned around.  After enough
+ * rounds that the pivots must be going wrong, heap_select finishes the job.
+ */
+static void floyd_rivest(char *base, size_t left, size_t right, size_t k,
+	size_t size, SortCompareT cmp, char *key, unsigned rounds)
+{
+	double n, i, z, s, sd;
+	size_t new_left, new_right, l, r;
+
+	while (right > left) {
+		if (!rounds--) {
+			heap_select(AT(left), right - left + 1, k - left + 1,
+				size, cmp);
+			swap(AT(left), AT(k), size);
+			return;
+		}
+		if (right - left > SAMPLE_CUTOFF) {
+			n = right - left + 1;
+			i = k - left + 1;
+			z = log(n);
+			s = 0.5 * exp(2 * z / 3);
+			sd = 0.5 * sqrt(z * s * (n - s) / n) *
+				(i < n / 2 ? -1 : 1);
+			new_left = k - i * s / n + sd > left
+				? k - i * s / n + sd : left;
+			new_right = k + (n - i) * s / n + sd < right
+				? k + (n - i) * s / n + sd : right;
+			floyd_rivest(base, new_left, new_right, k, size, cmp,
+				key, rounds);
+		}
+
+		/* Partition around the element at k. */
+		memcpy(key, AT(k), size);
+		swap(AT(left), AT(k), size);
+		if (cmp(AT(right), key) > 0)
+			swap(AT(right), AT(left), size);
+		for (l = left, r = right; l < r; ) {
+			swap(AT(l), AT(r), size);
+			++l;
+			--r;
+			while (cmp(AT(l), key) < 0)
+				++l;
+			while (cmp(AT(r), key) > 0)
+				--r;
+		}
+		if (cmp(AT(left), key) == 0) {
+			swap(AT(left), AT(r), size);
+		} else {
+			++r;
+			swap(AT(r), AT(right), size);
+		}
+
+		/* r now holds the pivot, keep the side k is on. */
+		if (r == k)
+			return;
+		if (r < k)
+			left = r + 1;
+		else
+			right = r - 1;
+	}
+}
+
+/*
+ * Rearranges the n elements of size bytes at base so that element k is the
+ * one that would be there if they were sorted by cmp, with none of the
+ * elements before it greater and none after it less.  Expected O(n) with
+ * about n + min(k, n - k) comparisons, O(n log n) at worst.  Not stable.
+ */
+void select_nth(void *base_, size_t n, size_t size, SortCompareT cmp,
+	size_t k)
+{
+	char *base = base_;
+	char small[64];
+	char *key;
+	unsigned rounds = 8;
+	size_t m;
+
+	if (k >= n)
+		return;
+	for (m = n; m > 1; m /= 2)
+		rounds += 2;
+	key = size <= sizeof(small) ? small : malloc(size);
+	if (!key) {
+		/* No room for the pivot, select with the heap instead. */
+		heap_select(base, n, k + 1, size, cmp);
+		swap(AT(0), AT(k), size);
+		return;
+	}
+	floyd_rivest(base, 0, n - 1, k, size, cmp, key, rounds);
+	if (key != small)
+		free(key);
+}
+
+/*
+ * Rearranges the n elements of size bytes at base so that the k smallest are
+ * at the front in sorted order.  The rest are left behind them in no
+ * particular order.  For small k a heap of the k smallest is kept over one
+ * pass, in O(n log k), and then sorted.  Otherwise select_nth splits off the
+ * k smallest and pdq_sort sorts them.  Nothing is allocated.  Not stable.
+ */
+void partial_sort(void *base_, size_t n, size_t size, SortCompareT cmp,
+	size_t k)
+{
+	char *base = base_;
+
+	if (k > n)
+		k = n;
+	if (!k)
+		return;
+	if (k < n / 16) {
+		heap_select(base, n, k, size, cmp);
+		sort_heap(base, k, size, cmp);
+		return;
+	}
+	if (k < n)
+		select_nth(base, n, size, cmp, k);
+	pdq_sort(base, k, size, cmp);
+}
@@ -28,42 +28,41 @@
  ******************************************************************************/
 
 /*************************************************************
- * Just a simple Selection Sort Demonstration using an int[] *
+ * Just a simple Selection Sort, for any element type        *
  *************************************************************/
 
- #include <stdio.h>
- #define ARRAYSIZE sizeof(arr)/sizeof(arr[0])
+#include <string.h>
+#include "sort.h"
 
-void swap(int *a, int *b)
+/* Swaps the size bytes at a and b. */
+static void swap(char *a, char *b, size_t size)
 {
-	int temp = *a;
-	*a = *b;
-	*b = temp;
-}
+	char temp;
 
-void sort(int *arr, unsigned size)
-{
-	unsigned i, j;
-	int *smallest;
-	for(i = 0; i < size - 1; ++i) {
-		smallest = &arr[i];
-		for(j = i + 1; j < size; ++j) {
-			if(arr[j] < *smallest)
-				smallest = &arr[j];
-		}
-		swap(smallest, &arr[i]);
+	while (size--) {
+		temp = *a;
+		*a++ = *b;
+		*b++ = temp;
 	}
-
 }
 
-int main(int argc, char **argv)
+/*
+ * Sorts the n elements of size bytes at base in the order of cmp, by
+ * swapping the smallest element left into each place in turn.  Not stable.
+ */
+void selection_sort(void *base, size_t n, size_t size, SortCompareT cmp)
 {
-	unsigned i;
-	int arr[10] = {10,9,8,7,6,5,4,3,2,1};
- 	sort(arr, ARRAYSIZE);
- 	for(i = 0; i < ARRAYSIZE; ++i)
- 		printf("%d ", arr[i]);
- 	printf("\n");
+	char *arr = base;
+	size_t i, j;
+	char *smallest;
 
- 	return 0;
-}
\ No newline at end of file
+	for (i = 0; i + 1 < n; ++i) {
+		smallest = arr + i * size;
+		for (j = i + 1; j < n; ++j) {
+			if (cmp(arr + j * size, smallest) < 0)
+				smallest = arr + j * size;
+		}
+		if (smallest != arr + i * size)
+			swap(smallest, arr + i * size, size);
+	}
+}
@@ -0,0 +1,390 @@
+/******************************************************************************
+ *    FILE: SimdSort.c                                                        *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*************************************************************
+ * SIMD kernels for sorting int32s: a sorting network for    *
+ * blocks of 64 ints and a bitonic merge of whole vectors,   *
+ * plus the Merge Sort of int32s that is built on them       *
+ *************************************************************/
+
+#include <immintrin.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+
+#define AVX2 __attribute__((target("avx2")))
+
+/* Ints in an AVX2 vector. */
+#define LANES 8
+
+/* Leaves the smaller ints of a and b in a and the bigger in b, lane by lane. */
+#define COMPARE_SWAP(a, b)                                                   \
+	do {                                                                 \
+		__m256i min = _mm256_min_epi32(a, b);                        \
+		b = _mm256_max_epi32(a, b);                                  \
+		a = min;                                                     \
+	} while (0)
+
+/*
+ * Merges the sorted runs [l_iter, l_end) and [r_iter, r_end) into out one int
+ * at a time.  If the two runs are already in order they are just copied.
+ */
+static void merge_scalar(int32_t const *l_iter, int32_t const *l_end,
+	int32_t const *r_iter, int32_t const *r_end, int32_t *out)
+{
+	if (l_iter == l_end || r_iter == r_end || l_end[-1] <= *r_iter) {
+		memcpy(out, l_iter, sizeof(int32_t) * (l_end - l_iter));
+		memcpy(out + (l_end - l_iter), r_iter,
+			sizeof(int32_t) * (r_end - r_iter));
+		return;
+	}
+
+	while (l_iter < l_end && r_iter < r_end) {
+		if (*r_iter < *l_iter)
+			*out++ = *r_iter++;
+		else
+			*out++ = *l_iter++;
+	}
+
+	while (l_iter < l_end)
+		*out++ = *l_iter++;
+	while (r_iter < r_end)
+		*out++ = *r_iter++;
+}
+
+/*
+ * Sorts a bitonic vector: compares and swaps the lanes 4, 2 and then 1 apart,
+ * keeping the smaller int in the lower lane each time.
+ */
+static inline AVX2 __m256i bitonic_sort8(__m256i v)
+{
+	__m256i p;
+
+	p = _mm256_permute2x128_si256(v, v, 1);
+	v = _mm256_blend_epi32(_mm256_min_epi32(v, p),
+		_mm256_max_epi32(v, p), 0xf0);
+	p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+	v = _mm256_blend_epi32(_mm256_min_epi32(v, p),
+		_mm256_max_epi32(v, p), 0xcc);
+	p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+	v = _mm256_blend_epi32(_mm256_min_epi32(v, p),
+		_mm256_max_epi32(v, p), 0xaa);
+	return v;
+}
+
+/*
+ * Merges the sorted vectors *lo and *hi, leaving the 8 smallest ints in *lo
+ * and the 8 biggest in *hi, both sorted.  Reversing *hi makes the pair one
+ * bitonic sequence, and one compare-swap splits it into two bitonic halves.
+ */
+static inline AVX2 void bitonic_merge8(__m256i *lo, __m256i *hi)
+{
+	__m256i const reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+	__m256i a = *lo;
+	__m256i b = _mm256_permutevar8x32_epi32(*hi, reverse);
+
+	COMPARE_SWAP(a, b);
+	*lo = bitonic_sort8(a);
+	*hi = bitonic_sort8(b);
+}
+
+/*
+ * Merges like merge_scalar, a vector at a time.  The 8 biggest ints seen so
+ * far stay in a register and are merged with the next 8 ints of whichever
+ * run has the smaller head, which makes the other 8 the next ones out.  Once
+ * the run that is due has less than a vector left, the rest is merged
+ * one int at a time.
+ */
+static AVX2 void merge_avx2(int32_t const *l_iter, int32_t const *l_end,
+	int32_t const *r_iter, int32_t const *r_end, int32_t *out)
+{
+	int32_t rest[LANES];
+	__m256i lo, hi;
+	size_t i;
+
+	if (l_end - l_iter < LANES || r_end - r_iter < LANES ||
+		l_end[-1] <= *r_iter) {
+		merge_scalar(l_iter, l_end, r_iter, r_end, out);
+		return;
+	}
+
+	lo = _mm256_loadu_si256((__m256i const*)l_iter);
+	hi = _mm256_loadu_si256((__m256i const*)r_iter);
+	l_iter += LANES;
+	r_iter += LANES;
+	for (;;) {
+		bitonic_merge8(&lo, &hi);
+		_mm256_storeu_si256((__m256i*)out, lo);
+		out += LANES;
+		if (r_iter == r_end || (l_iter < l_end && *l_iter <= *r_iter)) {
+			if (l_end - l_iter < LANES)
+				break;
+			lo = _mm256_loadu_si256((__m256i const*)l_iter);
+			l_iter += LANES;
+		} else {
+			if (r_end - r_iter < LANES)
+				break;
+			lo = _mm256_loadu_si256((__m256i const*)r_iter);
+			r_iter += LANES;
+		}
+	}
+
+	/* Three way merge of what is left in hi and in the two runs. */
+	_mm256_storeu_si256((__m256i*)rest, hi);
+	for (i = 0; i < LANES; ) {
+		if (l_iter < l_end && *l_iter < rest[i] &&
+			(r_iter == r_end || *l_iter <= *r_iter))
+			*out++ = *l_iter++;
+		else if (r_iter < r_end && *r_iter < rest[i])
+			*out++ = *r_iter++;
+		else
+			*out++ = rest[i++];
+	}
+	merge_scalar(l_iter, l_end, r_iter, r_end, out);
+}
+
+/*
+ * Sorts up to SORT_BLOCK_SIZE ints, padded out with INT32_MAX.  The 64 ints
+ * are loaded into 8 vectors and the 19 comparator network for 8 inputs sorts
+ * every lane across them.  A transpose turns the lanes into 8 sorted vectors,
+ * which are merged in pairs in registers and then by merge_avx2.
+ */
+static AVX2 void sort_block_avx2(int32_t *arr, size_t n)
+{
+	int32_t block[SORT_BLOCK_SIZE], buffer[SORT_BLOCK_SIZE];
+	__m256i r0, r1, r2, r3, r4, r5, r6, r7;
+	__m256i t0, t1, t2, t3, t4, t5, t6, t7;
+	size_t i;
+
+	memcpy(block, arr, sizeof(int32_t) * n);
+	for (i = n; i < SORT_BLOCK_SIZE; ++i)
+		block[i] = INT32_MAX;
+
+	r0 = _mm256_loadu_si256((__m256i const*)(block + 0 * LANES));
+	r1 = _mm256_loadu_si256((__m256i const*)(block + 1 * LANES));
+	r2 = _mm256_loadu_si256((__m256i const*)(block + 2 * LANES));
+	r3 = _mm256_loadu_si256((__m256i const*)(block + 3 * LANES));
+	r4 = _mm256_loadu_si256((__m256i const*)(block + 4 * LANES));
+	r5 = _mm256_loadu_si256((__m256i const*)(block + 5 * LANES));
+	r6 = _mm256_loadu_si256((__m256i const*)(block + 6 * LANES));
+	r7 = _mm256_loadu_si256((__m256i const*)(block + 7 * LANES));
+
+	COMPARE_SWAP(r0, r2); COMPARE_SWAP(r1, r3);
+	COMPARE_SWAP(r4, r6); COMPARE_SWAP(r5, r7);
+	COMPARE_SWAP(r0, r4); COMPARE_SWAP(r1, r5);
+	COMPARE_SWAP(r2, r6); COMPARE_SWAP(r3, r7);
+	COMPARE_SWAP(r0, r1); COMPARE_SWAP(r2, r3);
+	COMPARE_SWAP(r4, r5); COMPARE_SWAP(r6, r7);
+	COMPARE_SWAP(r2, r4); COMPARE_SWAP(r3, r5);
+	COMPARE_SWAP(r1, r4); COMPARE_SWAP(r3, r6);
+	COMPARE_SWAP(r1, r2); COMPARE_SWAP(r3, r4); COMPARE_SWAP(r5, r6);
+
+	t0 = _mm256_unpacklo_epi32(r0, r1);
+	t1 = _mm256_unpackhi_epi32(r0, r1);
+	t2 = _mm256_unpacklo_epi32(r2, r3);
+	t3 = _mm256_unpackhi_epi32(r2, r3);
+	t4 = _mm256_unpacklo_epi32(r4, r5);
+	t5 = _mm256_unpackhi_epi32(r4, r5);
+	t6 = _mm256_unpacklo_epi32(r6, r7);
+	t7 = _mm256_unpackhi_epi32(r6, r7);
+	r0 = _mm256_unpacklo_epi64(t0, t2);
+	r1 = _mm256_unpackhi_epi64(t0, t2);
+	r2 = _mm256_unpacklo_epi64(t1, t3);
+	r3 = _mm256_unpackhi_epi64(t1, t3);
+	r4 = _mm256_unpacklo_epi64(t4, t6);
+	r5 = _mm256_unpackhi_epi64(t4, t6);
+	r6 = _mm256_unpacklo_epi64(t5, t7);
+	r7 = _mm256_unpackhi_epi64(t5, t7);
+	t0 = _mm256_permute2x128_si256(r0, r4, 0x20);
+	t1 = _mm256_permute2x128_si256(r1, r5, 0x20);
+	t2 = _mm256_permute2x128_si256(r2, r6, 0x20);
+	t3 = _mm256_permute2x128_si256(r3, r7, 0x20);
+	t4 = _mm256_permute2x128_si256(r0, r4, 0x31);
+	t5 = _mm256_permute2x128_si256(r1, r5, 0x31);
+	t6 = _mm256_permute2x128_si256(r2, r6, 0x31);
+	t7 = _mm256_permute2x128_si256(r3, r7, 0x31);
+
+	bitonic_merge8(&t0, &t1);
+	bitonic_merge8(&t2, &t3);
+	bitonic_merge8(&t4, &t5);
+	bitonic_merge8(&t6, &t7);
+	_mm256_storeu_si256((__m256i*)(buffer + 0 * LANES), t0);
+	_mm256_storeu_si256((__m256i*)(buffer + 1 * LANES), t1);
+	_mm256_storeu_si256((__m256i*)(buffer + 2 * LANES), t2);
+	_mm256_storeu_si256((__m256i*)(buffer + 3 * LANES), t3);
+	_mm256_storeu_si256((__m256i*)(buffer + 4 * LANES), t4);
+	_mm256_storeu_si256((__m256i*)(buffer + 5 * LANES), t5);
+	_mm256_storeu_si256((__m256i*)(buffer + 6 * LANES), t6);
+	_mm256_storeu_si256((__m256i*)(buffer + 7 * LANES), t7);
+
+	merge_avx2(buffer, buffer + 16, buffer + 16, buffer + 32, block);
+	merge_avx2(buffer + 32, buffer + 48, buffer + 48, buffer + 64,
+		block + 32);
+	merge_avx2(block, block + 32, block + 32, block + 64, buffer);
+	memcpy(arr, buffer, sizeof(int32_t) * n);
+}
+
+/* Sorts up to SORT_BLOCK_SIZE ints as two insertion sorted runs and a merge. */
+static void sort_block_scalar(int32_t *arr, size_t n)
+{
+	int32_t buffer[SORT_BLOCK_SIZE];
+	size_t half = n < SORT_RUN_SIZE ? n : SORT_RUN_SIZE;
+
+	insertion_sort_int32(arr, half);
+	if (half == n)
+		return;
+	insertion_sort_int32(arr + half, n - half);
+	merge_scalar(arr, arr + half, arr + half, arr + n, buffer);
+	memcpy(arr, buffer, sizeof(int32_t) * n);
+}
+
+/* One variant of the kernels, name is what SORT_KERNELS is compared against. */
+struct Kernels {
+	char const *name;
+	void (*sort_block)(int32_t *arr, size_t n);
+	void (*merge)(int32_t const *l_iter, int32_t const *l_end,
+		int32_t const *r_iter, int32_t const *r_end, int32_t *out);
+};
+
+/* Every variant, the one to prefer first.  The last one runs anywhere. */
+static struct Kernels const kernels[] = {
+	{ "avx2", sort_block_avx2, merge_avx2 },
+	{ "scalar", sort_block_scalar, merge_scalar }
+};
+
+#define NKERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+static struct Kernels const *chosen;
+
+/*
+ * Picks the kernels once, for the CPU we are running on.  The SORT_KERNELS
+ * environment variable can name the variant to use instead so they can be
+ * timed against each other, a name the CPU can't run is ignored.
+ */
+static void choose_kernels(void)
+{
+	char const *forced = getenv("SORT_KERNELS");
+	int supported[NKERNELS];
+	size_t i;
+
+	__builtin_cpu_init();
+	supported[0] = __builtin_cpu_supports("avx2");
+	supported[1] = 1;
+
+	for (i = 0; forced && i < NKERNELS; ++i) {
+		if (supported[i] && !strcmp(forced, kernels[i].name)) {
+			chosen = &kernels[i];
+			return;
+		}
+	}
+	for (i = 0; !supported[i]; ++i)
+		;
+	chosen = &kernels[i];
+}
+
+static struct Kernels const *get_kernels(void)
+{
+	pthread_once(&kernels_once, choose_kernels);
+	return chosen;
+}
+
+/* Names the variant of the kernels that was picked. */
+char const *sort_kernels(void)
+{
+	return get_kernels()->name;
+}
+
+/* Sorts n <= SORT_BLOCK_SIZE ints with the best kernel the CPU runs. */
+void sort_block_int32(int32_t *arr, size_t n)
+{
+	if (n < 2)
+		return;
+	get_kernels()->sort_block(arr, n);
+}
+
+/* Merges two sorted runs with the best kernel the CPU runs. */
+void merge_int32(int32_t const *left, size_t l_n, int32_t const *right,
+	size_t r_n, int32_t *out)
+{
+	get_kernels()->merge(left, left + l_n, right, right + r_n, out);
+}
+
+/*
+ * Merge sorts n int32s using the n ints at buffer as scratch space.  It
+ * starts from runs of SORT_BLOCK_SIZE sorted by sort_block_int32 and merges
+ * them bottom-up from one buffer into the other with merge_int32.
+ */
+void merge_sort_int32_buffer(int32_t *arr, int32_t *buffer, size_t n)
+{
+	size_t width, i, middle, last;
+	int32_t *from = arr;
+	int32_t *to = buffer;
+	int32_t *temp;
+
+	for (i = 0; i < n; i += SORT_BLOCK_SIZE)
+		sort_block_int32(arr + i,
+			i + SORT_BLOCK_SIZE < n ? SORT_BLOCK_SIZE : n - i);
+
+	for (width = SORT_BLOCK_SIZE; width < n; width *= 2) {
+		for (i = 0; i < n; i += 2 * width) {
+			middle = i + width < n ? i + width : n;
+			last = i + 2 * width < n ? i + 2 * width : n;
+			merge_int32(from + i, middle - i, from + middle,
+				last - middle, to + i);
+		}
+		temp = from;
+		from = to;
+		to = temp;
+	}
+	if (from != arr)
+		memcpy(arr, from, sizeof(int32_t) * n);
+}
+
+/*
+ * The typed merge sort of int32s.  It works like the ones SORT_DEFINE makes,
+ * but is built on the SIMD kernels by merge_sort_int32_buffer, and like them
+ * returns 0 with the array untouched if it can't get its buffer.
+ */
+int merge_sort_int32(int32_t *arr, size_t n)
+{
+	int32_t *buffer;
+
+	if (n <= SORT_BLOCK_SIZE) {
+		sort_block_int32(arr, n);
+		return 1;
+	}
+	buffer = malloc(sizeof(int32_t) * n);
+	if (!buffer)
+		return 0;
+	merge_sort_int32_buffer(arr, buffer, n);
+	free(buffer);
+	return 1;
+}
@@ -0,0 +1,150 @@
+/******************************************************************************
+ *    FILE: TagSort.c                                                         *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*************************************************************
+ * A Tag Sort for arrays of big records: small (key prefix,  *
+ * record) tags are sorted instead of the records, which are *
+ * then moved at most once                                   *
+ *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+
+/*
+ * Merge sorts the n record pointers at tags by cmp on the records, using
+ * the n pointers at buffer as scratch.  Stable, so tags with equal records
+ * stay in array order.
+ */
+static void sort_ties(char const **tags, char const **buffer, size_t n,
+	SortCompareT cmp)
+{
+	size_t half = n / 2, l, r, i;
+
+	if (n < 2)
+		return;
+	sort_ties(tags, buffer, half, cmp);
+	sort_ties(tags + half, buffer, n - half, cmp);
+	if (cmp(tags[half], tags[half - 1]) >= 0)
+		return;
+
+	memcpy(buffer, tags, sizeof(char const*) * half);
+	for (i = 0, l = 0, r = half; l < half; ++i) {
+		if (r < n && cmp(tags[r], buffer[l]) < 0)
+			tags[i] = tags[r++];
+		else
+			tags[i] = buffer[l++];
+	}
+}
+
+/*
+ * Moves the records of base to where they belong in place.  order[i] is the
+ * index of the record that goes at i.  Each cycle of the permutation is
+ * followed around once, so every record is copied once, plus once more per
+ * cycle through temp.  order is used up.
+ */
+static void permute(char *base, size_t n, size_t size, uint64_t *order,
+	char *temp)
+{
+	size_t i, j, k;
+
+	for (i = 0; i < n; ++i) {
+		if (order[i] == i)
+			continue;
+		memcpy(temp, base + i * size, size);
+		for (j = i; (k = order[j]) != i; j = k) {
+			memcpy(base + j * size, base + k * size, size);
+			order[j] = j;
+		}
+		memcpy(base + j * size, temp, size);
+		order[j] = j;
+	}
+}
+
+/*
+ * Sorts the n records of size bytes at base in the order of cmp, for records
+ * big enough that moving them costs more than comparing them.  A tag of
+ * every record, its key prefix and its address, is sorted: radix sorted by
+ * the prefix, then runs of equal prefixes are merge sorted by cmp.  The
+ * records themselves only move at the end, once each.
+ *
+ * arg: prefix maps a record to 64 bits such that a smaller prefix means the
+ * record goes first, e.g. the first 8 bytes of a string key big endian.
+ * Records with equal prefixes are compared with cmp.  NULL compares every
+ * record with cmp.
+ * arg: out, if not NULL, is where the sorted records are gathered, and base
+ * is not touched.  Otherwise they are put in order in place.
+ *
+ * Returns 1, or 0 with nothing moved if memory could not be allocated.
+ * Stable.
+ */
+int tag_sort(void *base, size_t n, size_t size, SortCompareT cmp,
+	SortPrefixT prefix, void *out)
+{
+	char *arr = base;
+	uint64_t *keys = malloc(sizeof(uint64_t) * (n ? n : 1));
+	char const **tags = malloc(sizeof(char const*) * (n ? n : 1));
+	char const **buffer = malloc(sizeof(char const*) * (n / 2 + 1));
+	char *temp = out ? NULL : malloc(size);
+	size_t i, j;
+	int ok = 0;
+
+	if (!keys || !tags || !buffer || (!out && !temp))
+		goto done;
+
+	for (i = 0; i < n; ++i) {
+		keys[i] = prefix ? prefix(arr + i * size) : 0;
+		tags[i] = arr + i * size;
+	}
+	if (prefix && !radix_sort_uint64_payload(keys, tags,
+		sizeof(char const*), n))
+		goto done;
+	for (i = 0; i < n; i = j) {
+		for (j = i + 1; j < n && keys[j] == keys[i]; ++j)
+			;
+		sort_ties(tags + i, buffer, j - i, cmp);
+	}
+
+	if (out) {
+		for (i = 0; i < n; ++i)
+			memcpy((char*)out + i * size, tags[i], size);
+	} else {
+		for (i = 0; i < n; ++i)
+			keys[i] = (tags[i] - arr) / size;
+		permute(arr, n, size, keys, temp);
+	}
+	ok = 1;
+
+done:
+	free(keys);
+	free(tags);
+	free(buffer);
+	free(temp);
+	return ok;
+}
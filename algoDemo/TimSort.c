@@ -0,0 +1,597 @@
+/******************************************************************************
+ *    FILE: TimSort.c                                                         *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/*************************************************************
+ * An adaptive Merge Sort in the style of TimSort, for any   *
+ * element type.  It finds the runs already in the input,    *
+ * so sorted and nearly sorted arrays take close to O(n).    *
+ *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+
+/* Galloping starts after this many wins in a row by the same run. */
+#define MIN_GALLOP 7
+
+/* Deep enough for the run stack of any array that fits in memory. */
+#define MAX_RUNS 85
+
+/* Address of element i of an array of state size elements. */
+#define AT(arr, i) ((arr) + (size_t)(i) * s->size)
+
+struct Run {
+	size_t base, length;
+};
+
+/*
+ * The state of one sort.  runs is the stack of runs waiting to be merged,
+ * tmp the buffer that holds the smaller run of a merge and key the room to
+ * hold one element aside.
+ */
+struct State {
+	char *arr;
+	size_t n, size;
+	SortCompareT cmp;
+	struct Run runs[MAX_RUNS];
+	size_t runs_n;
+	size_t min_gallop;
+	char *tmp;
+	size_t tmp_n;
+	char *key;
+};
+
+/*
+ * Returns the shortest run worth merging: n / 2^k for some k, rounded up if
+ * any bits were shifted out, so that n / minrun is a power of two or just
+ * below one and the merges stay balanced.
+ */
+static size_t min_run(size_t n)
+{
+	size_t r = 0;
+
+	while (n >= 64) {
+		r |= n & 1;
+		n >>= 1;
+	}
+	return n + r;
+}
+
+/* Reverses the elements [lo, hi) in place. */
+static void reverse(struct State *s, size_t lo, size_t hi)
+{
+	size_t k;
+	char temp, *a, *b;
+
+	for (; lo + 1 < hi; ++lo, --hi) {
+		a = AT(s->arr, lo);
+		b = AT(s->arr, hi - 1);
+		for (k = 0; k < s->size; ++k) {
+			temp = a[k];
+			a[k] = b[k];
+			b[k] = temp;
+		}
+	}
+}
+
+/*
+ * Returns the length of the run starting at lo and ending before hi.  A run
+ * is either non-descending or strictly descending, and a descending run is
+ * reversed so it ascends.  Strictly, so that reversing keeps it stable.
+ */
+static size_t count_run(struct State *s, size_t lo, size_t hi)
+{
+	size_t i = lo + 1;
+
+	if (i == hi)
+		return 1;
+	if (s->cmp(AT(s->arr, i), AT(s->arr, lo)) < 0) {
+		for (++i; i < hi &&
+			s->cmp(AT(s->arr, i), AT(s->arr, i - 1)) < 0; ++i)
+			;
+		reverse(s, lo, i);
+	} else {
+		for (++i; i < hi &&
+			s->cmp(AT(s->arr, i), AT(s->arr, i - 1)) >= 0; ++i)
+			;
+	}
+	return i - lo;
+}
+
+/*
+ * Sorts [lo, hi), of which [lo, start) is already sorted, by inserting the
+ * rest one at a time at the place a binary search finds.  After any equal
+ * elements, to keep it stable.
+ */
+static void binary_insertion_sort(struct State *s, size_t lo, size_t hi,
+	size_t start)
+{
+	size_t left, right, middle;
+
+	for (; start < hi; ++start) {
+		memcpy(s->key, AT(s->arr, start), s->size);
+		for (left = lo, right = start; left < right; ) {
+			middle = left + (right - left) / 2;
+			if (s->cmp(s->key, AT(s->arr, middle)) < 0)
+				right = middle;
+			else
+				left = middle + 1;
+		}
+		memmove(AT(s->arr, left + 1), AT(s->arr, left),
+			(start - left) * s->size);
+		memcpy(AT(s->arr, left), s->key, s->size);
+	}
+}
+
+/*
+ * Finds where key goes in the sorted n elements at a: the index of the first
+ * element that is not less than it.  The search starts at hint and gallops
+ * away from it in steps of 1, 3, 7, ... before a binary search, so it is
+ * cheap when the answer is close to the hint.
+ */
+static size_t gallop_left(struct State *s, char const *key, char const *a,
+	size_t n, size_t hint)
+{
+	ptrdiff_t last = 0, ofs = 1, max, k, m;
+
+	if (s->cmp(AT(a, hint), key) < 0) {
+		max = n - hint;
+		while (ofs < max && s->cmp(AT(a, hint + ofs), key) < 0) {
+			last = ofs;
+			ofs = 2 * ofs + 1;
+		}
+		ofs = ofs < max ? ofs : max;
+		last += hint;
+		ofs += hint;
+	} else {
+		max = hint + 1;
+		while (ofs < max && s->cmp(AT(a, hint - ofs), key) >= 0) {
+			last = ofs;
+			ofs = 2 * ofs + 1;
+		}
+		ofs = ofs < max ? ofs : max;
+		k = last;
+		last = hint - ofs;
+		ofs = hint - k;
+	}
+
+	/* a[last] < key <= a[ofs], so the answer is in (last, ofs]. */
+	for (++last; last < ofs; ) {
+		m = last + (ofs - last) / 2;
+		if (s->cmp(AT(a, m), key) < 0)
+			last = m + 1;
+		else
+			ofs = m;
+	}
+	return ofs;
+}
+
+/*
+ * Like gallop_left, but finds the index of the first element greater than
+ * key, which is after any equal ones.
+ */
+static size_t gallop_right(struct State *s, char const *key, char const *a,
+	size_t n, size_t hint)
+{
+	ptrdiff_t last = 0, ofs = 1, max, k, m;
+
+	if (s->cmp(key, AT(a, hint)) < 0) {
+		max = hint + 1;
+		while (ofs < max && s->cmp(key, AT(a, hint - ofs)) < 0) {
+			last = ofs;
+			ofs = 2 * ofs + 1;
+		}
+		ofs = ofs < max ? ofs : max;
+		k = last;
+		last = hint - ofs;
+		ofs = hint - k;
+	} else {
+		max = n - hint;
+		while (ofs < max && s->cmp(key, AT(a, hint + ofs)) >= 0) {
+			last = ofs;
+			ofs = 2 * ofs + 1;
+		}
+		ofs = ofs < max ? ofs : max;
+		last += hint;
+		ofs += hint;
+	}
+
+	/* a[last] <= key < a[ofs], so the answer is in (last, ofs]. */
+	for (++last; last < ofs; ) {
+		m = last + (ofs - last) / 2;
+		if (s->cmp(key, AT(a, m)) < 0)
+			ofs = m;
+		else
+			last = m + 1;
+	}
+	return ofs;
+}
+
+/* Makes tmp hold at least need elements.  Returns 0 if it could not. */
+static int ensure_tmp(struct State *s, size_t need)
+{
+	size_t n = s->tmp_n * 2;
+
+	if (need <= s->tmp_n)
+		return 1;
+	n = n < need ? need : n;
+	n = n > s->n / 2 ? s->n / 2 : n;
+	free(s->tmp);
+	s->tmp = malloc(n * s->size);
+	s->tmp_n = s->tmp ? n : 0;
+	return s->tmp != NULL;
+}
+
+/*
+ * Merges the runs at base1 and base1 + len1 when the first is the shorter.
+ * It is copied to tmp and merged from the front.  The first element of the
+ * second run goes first and the last element of the first run goes last,
+ * merge_at made sure of that.  Once one run wins min_gallop times in a row
+ * the merge gallops, copying whole stretches found by gallop_left and
+ * gallop_right, for as long as the stretches stay long.
+ */
+static void merge_lo(struct State *s, size_t base1, size_t len1,
+	size_t len2)
+{
+	size_t const size = s->size;
+	char *dest = AT(s->arr, base1);
+	char *c1 = s->tmp;
+	char *c2 = AT(s->arr, base1 + len1);
+	size_t a_wins, b_wins, k;
+
+	memcpy(s->tmp, dest, len1 * size);
+	memcpy(dest, c2, size);
+	dest += size;
+	c2 += size;
+	if (--len2 == 0)
+		goto done;
+	if (len1 == 1)
+		goto last_a;
+
+	for (;;) {
+		a_wins = b_wins = 0;
+		do {
+			if (s->cmp(c2, c1) < 0) {
+				memcpy(dest, c2, size);
+				dest += size;
+				c2 += size;
+				++b_wins;
+				a_wins = 0;
+				if (--len2 == 0)
+					goto done;
+			} else {
+				memcpy(dest, c1, size);
+				dest += size;
+				c1 += size;
+				++a_wins;
+				b_wins = 0;
+				if (--len1 == 1)
+					goto last_a;
+			}
+		} while (a_wins < s->min_gallop && b_wins < s->min_gallop);
+
+		++s->min_gallop;
+		do {
+			s->min_gallop -= s->min_gallop > 1;
+			a_wins = k = gallop_right(s, c2, c1, len1, 0);
+			if (k) {
+				memcpy(dest, c1, k * size);
+				dest += k * size;
+				c1 += k * size;
+				len1 -= k;
+				if (len1 == 1)
+					goto last_a;
+				if (len1 == 0)
+					goto done;
+			}
+			memcpy(dest, c2, size);
+			dest += size;
+			c2 += size;
+			if (--len2 == 0)
+				goto done;
+
+			b_wins = k = gallop_left(s, c1, c2, len2, 0);
+			if (k) {
+				memmove(dest, c2, k * size);
+				dest += k * size;
+				c2 += k * size;
+				len2 -= k;
+				if (len2 == 0)
+					goto done;
+			}
+			memcpy(dest, c1, size);
+			dest += size;
+			c1 += size;
+			if (--len1 == 1)
+				goto last_a;
+		} while (a_wins >= MIN_GALLOP || b_wins >= MIN_GALLOP);
+		++s->min_gallop;
+	}
+
+done:
+	memcpy(dest, c1, len1 * size);
+	return;
+last_a:
+	/* One element of the first run is left and it goes after the rest. */
+	memmove(dest, c2, len2 * size);
+	memcpy(dest + len2 * size, c1, size);
+}
+
+/*
+ * Merges the runs at base1 and base1 + len1 when the second is the shorter.
+ * Like merge_lo the other way around: the second run is copied to tmp and
+ * they are merged from the back.  Indexes instead of pointers, since the
+ * cursors may step to just before the start of their arrays.
+ */
+static void merge_hi(struct State *s, size_t base1, size_t len1,
+	size_t len2)
+{
+	size_t const size = s->size;
+	char *a = s->arr;
+	char *b = s->tmp;
+	ptrdiff_t dest = base1 + len1 + len2 - 1;
+	ptrdiff_t c1 = base1 + len1 - 1;
+	ptrdiff_t c2 = len2 - 1;
+	size_t a_wins, b_wins, k;
+
+	memcpy(b, AT(a, base1 + len1), len2 * size);
+	memcpy(AT(a, dest--), AT(a, c1--), size);
+	if (--len1 == 0)
+		goto done;
+	if (len2 == 1)
+		goto last_b;
+
+	for (;;) {
+		a_wins = b_wins = 0;
+		do {
+			if (s->cmp(AT(b, c2), AT(a, c1)) < 0) {
+				memcpy(AT(a, dest--), AT(a, c1--), size);
+				++a_wins;
+				b_wins = 0;
+				if (--len1 == 0)
+					goto done;
+			} else {
+				memcpy(AT(a, dest--), AT(b, c2--), size);
+				++b_wins;
+				a_wins = 0;
+				if (--len2 == 1)
+					goto last_b;
+			}
+		} while (a_wins < s->min_gallop && b_wins < s->min_gallop);
+
+		++s->min_gallop;
+		do {
+			s->min_gallop -= s->min_gallop > 1;
+			k = gallop_right(s, AT(b, c2), AT(a, base1), len1,
+				len1 - 1);
+			a_wins = k = len1 - k;
+			if (k) {
+				dest -= k;
+				c1 -= k;
+				memmove(AT(a, dest + 1), AT(a, c1 + 1),
+					k * size);
+				len1 -= k;
+				if (len1 == 0)
+					goto done;
+			}
+			memcpy(AT(a, dest--), AT(b, c2--), size);
+			if (--len2 == 1)
+				goto last_b;
+
+			k = gallop_left(s, AT(a, c1), b, len2, len2 - 1);
+			b_wins = k = len2 - k;
+			if (k) {
+				dest -= k;
+				c2 -= k;
+				memcpy(AT(a, dest + 1), AT(b, c2 + 1),
+					k * size);
+				len2 -= k;
+				if (len2 == 1)
+					goto last_b;
+				if (len2 == 0)
+					goto done;
+			}
+			memcpy(AT(a, dest--), AT(a, c1--), size);
+			if (--len1 == 0)
+				goto done;
+		} while (a_wins >= MIN_GALLOP || b_wins >= MIN_GALLOP);
+		++s->min_gallop;
+	}
+
+done:
+	if (len2)
+		memcpy(AT(a, dest - (ptrdiff_t)len2 + 1), b, len2 * size);
+	return;
+last_b:
+	/* One element of the second run is left and it goes before the rest. */
+	dest -= len1;
+	c1 -= len1;
+	memmove(AT(a, dest + 1), AT(a, c1 + 1), len1 * size);
+	memcpy(AT(a, dest), AT(b, c2), size);
+}
+
+/*
+ * Merges the runs at base1 and base1 + len1 without tmp, for when it could
+ * not be grown.  The longer run is cut in half, the other run is cut where
+ * that middle element goes, and the two inner pieces swap places by three
+ * reversals.  Then the pieces on each side are merged the same way.  Stable,
+ * since equal elements never pass each other, and O(n log n) per merge.
+ */
+static void merge_in_place(struct State *s, size_t base1, size_t len1,
+	size_t len2)
+{
+	size_t cut1, cut2, middle;
+
+	while (len1 && len2) {
+		if (len1 + len2 == 2) {
+			if (s->cmp(AT(s->arr, base1 + 1),
+				AT(s->arr, base1)) < 0)
+				reverse(s, base1, base1 + 2);
+			return;
+		}
+		if (len1 >= len2) {
+			cut1 = len1 / 2;
+			cut2 = gallop_left(s, AT(s->arr, base1 + cut1),
+				AT(s->arr, base1 + len1), len2, 0);
+		} else {
+			cut2 = len2 / 2;
+			cut1 = gallop_right(s, AT(s->arr, base1 + len1 + cut2),
+				AT(s->arr, base1), len1, 0);
+		}
+
+		/* Swap [base1 + cut1, middle) and [middle, middle + cut2). */
+		middle = base1 + len1;
+		reverse(s, base1 + cut1, middle);
+		reverse(s, middle, middle + cut2);
+		reverse(s, base1 + cut1, middle + cut2);
+
+		/* Recurse on the left pieces and loop on the right ones. */
+		merge_in_place(s, base1, cut1, cut2);
+		base1 += cut1 + cut2;
+		len1 -= cut1;
+		len2 -= cut2;
+	}
+}
+
+/*
+ * Merges runs i and i + 1 of the stack.  Elements of the first run that are
+ * already in place in front of the second, and elements of the second that
+ * are already in place after the first, are found by galloping and left out
+ * of the merge.  If tmp can't be grown for the rest the runs are merged in
+ * place instead, which is slower but needs no memory.
+ */
+static void merge_at(struct State *s, size_t i)
+{
+	size_t base1 = s->runs[i].base, len1 = s->runs[i].length;
+	size_t base2 = s->runs[i + 1].base, len2 = s->runs[i + 1].length;
+	size_t k;
+
+	s->runs[i].length = len1 + len2;
+	if (i + 3 == s->runs_n)
+		s->runs[i + 1] = s->runs[i + 2];
+	--s->runs_n;
+
+	k = gallop_right(s, AT(s->arr, base2), AT(s->arr, base1), len1, 0);
+	base1 += k;
+	len1 -= k;
+	if (len1 == 0)
+		return;
+	len2 = gallop_left(s, AT(s->arr, base1 + len1 - 1), AT(s->arr, base2),
+		len2, len2 - 1);
+	if (len2 == 0)
+		return;
+
+	if (!ensure_tmp(s, len1 < len2 ? len1 : len2))
+		merge_in_place(s, base1, len1, len2);
+	else if (len1 <= len2)
+		merge_lo(s, base1, len1, len2);
+	else
+		merge_hi(s, base1, len1, len2);
+}
+
+/*
+ * Merges runs on the top of the stack until the lengths of the runs on it
+ * shrink faster than the Fibonacci numbers going up, which keeps the merges
+ * balanced and the stack shallow.
+ */
+static void merge_collapse(struct State *s)
+{
+	size_t i, a, b, c, d;
+
+	while (s->runs_n > 1) {
+		i = s->runs_n - 2;
+		/* a, b, c and d are the lengths of the runs from the top down. */
+		a = s->runs[i + 1].length;
+		b = s->runs[i].length;
+		c = i > 0 ? s->runs[i - 1].length : 0;
+		d = i > 1 ? s->runs[i - 2].length : 0;
+		if ((i > 0 && c <= b + a) || (i > 1 && d <= c + b)) {
+			if (c < a)
+				--i;
+		} else if (b > a) {
+			break;
+		}
+		merge_at(s, i);
+	}
+}
+
+/* Merges every run left on the stack. */
+static void merge_force_collapse(struct State *s)
+{
+	size_t i;
+
+	while (s->runs_n > 1) {
+		i = s->runs_n - 2;
+		if (i > 0 && s->runs[i - 1].length < s->runs[i + 1].length)
+			--i;
+		merge_at(s, i);
+	}
+}
+
+/*
+ * Sorts the n elements of size bytes at base in the order of cmp.  The input
+ * is cut into the runs that are already in it, with descending ones turned
+ * around.  Runs shorter than min_run are made that long by binary insertion
+ * sort, and the runs are merged off a stack as they are found.  Stable.
+ *
+ * Merges that can't get a buffer are done in place.  Returns 1, or 0 with the
+ * array untouched if there was no room to hold an element of more than 64
+ * bytes aside.
+ */
+int tim_sort(void *base, size_t n, size_t size, SortCompareT cmp)
+{
+	struct State state = { base, n, size, cmp };
+	struct State *s = &state;
+	char small[64];
+	size_t lo, run, minrun = min_run(n);
+
+	if (n < 2)
+		return 1;
+	s->min_gallop = MIN_GALLOP;
+	s->key = size <= sizeof(small) ? small : malloc(size);
+	if (!s->key)
+		return 0;
+
+	for (lo = 0; lo < n; lo += run) {
+		run = count_run(s, lo, n);
+		if (run < minrun) {
+			binary_insertion_sort(s, lo,
+				n - lo < minrun ? n : lo + minrun, lo + run);
+			run = n - lo < minrun ? n - lo : minrun;
+		}
+		s->runs[s->runs_n++] = (struct Run){ lo, run };
+		merge_collapse(s);
+	}
+	merge_force_collapse(s);
+
+	if (s->key != small)
+		free(s->key);
+	free(s->tmp);
+	return 1;
+}
@@ -0,0 +1,284 @@
+/******************************************************************************
+ *    FILE: sort.h                                                            *
+ *    AUTHOR: David L Patrzeba                                                *
+ *    E-MAIL: david.patrzeba@gmail.com                                        *                                  *
+ *                                                                            *
+ *    The MIT Liscense                                                        *
+ *    Copyright (c) 2013 David L patrzeba                                     *
+ *                                                                            *
+ *    Permission is hereby granted, free of charge, to any person obtaining a *
+ *    copy of this software and associated documentation files (the           *
+ *    "Software"), to deal in the Software without restriction, including     *
+ *    without limitation the rights to use, copy, modify, merge, publish,     *
+ *    distribute, sublicense, and/or sell copies of the Software, and to      *
+ *    permit persons to whom the Software is furnished to do so, subject to   *
+ *    the following conditions:                                               *
+ *                                                                            *
+ *    The above copyright notice and this permission notice shall be included *
+ *    in all copies or substantial portions of the Software.                  *
+ *                                                                            *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS *
+ *    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF              *
+ *    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  *
+ *    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY    *
+ *    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,    *
+ *    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE       *
+ *    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                  *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef SORT_H
+#define SORT_H
+
+/*************************************************************
+ * The sorts of algoDemo as a library.  Every sort comes in  *
+ * a generic, qsort-style version and in typed versions      *
+ * made by SORT_DEFINE for int32, int64, double and string.  *
+ *************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A qsort-style comparator: < 0 if the 1st element goes first, 0 if the two
+ * are equal, > 0 if the 2nd element goes first.
+ */
+typedef int (*SortCompareT)(void const*, void const*);
+
+/* Runs of this many elements are insertion sorted before merging. */
+#define SORT_RUN_SIZE 32
+
+/*
+ * The generic sorts.  base points at n elements of size bytes each and cmp
+ * orders them.  insertion_sort and merge_sort are stable, selection_sort is
+ * not.  merge_sort needs a buffer as big as the array and returns 0 if it
+ * could not get one, leaving the array as it was, 1 otherwise.
+ */
+void insertion_sort(void *base, size_t n, size_t size, SortCompareT cmp);
+void selection_sort(void *base, size_t n, size_t size, SortCompareT cmp);
+int merge_sort(void *base, size_t n, size_t size, SortCompareT cmp);
+
+/*
+ * Maps an element to a 64 bit key prefix: an element with a smaller prefix
+ * goes first, elements with equal ones are compared.
+ */
+typedef uint64_t (*SortPrefixT)(void const*);
+
+/*
+ * Sorts big records by sorting (prefix, address) tags and then moving every
+ * record once, in place or into out if it is not NULL, see TagSort.c.
+ * Stable.  Returns 0 with nothing moved if it could not allocate the tags,
+ * 1 otherwise.
+ */
+int tag_sort(void *base, size_t n, size_t size, SortCompareT cmp,
+	SortPrefixT prefix, void *out);
+
+/*
+ * In place sorts that never allocate.  pdq_sort is a pattern-defeating
+ * quicksort, see PdqSort.c, and the one to use.  heap_sort is its fallback,
+ * see Select.c.  Both are O(n log n) at worst and not stable.
+ */
+void pdq_sort(void *base, size_t n, size_t size, SortCompareT cmp);
+void heap_sort(void *base, size_t n, size_t size, SortCompareT cmp);
+
+/*
+ * An adaptive, stable merge sort in the style of TimSort, see TimSort.c.  It
+ * takes advantage of runs already in the input, so sorted, reversed and
+ * nearly sorted arrays take close to O(n).  Merges it can't get a buffer for
+ * are done in place.  Returns 0 with the array untouched if it could not
+ * allocate room for one element bigger than 64 bytes, 1 otherwise.
+ */
+int tim_sort(void *base, size_t n, size_t size, SortCompareT cmp);
+
+/*
+ * Selection for when only part of the order is needed, see Select.c.
+ * select_nth puts element k where a full sort would, with nothing greater
+ * in front of it and nothing less behind it, in expected O(n).  partial_sort
+ * puts the k smallest elements at the front in order, in O(n log k) or
+ * O(n + k log k).  Neither is stable.  Neither allocates, except select_nth for
+ * elements bigger than 64 bytes.
+ */
+void select_nth(void *base, size_t n, size_t size, SortCompareT cmp,
+	size_t k);
+void partial_sort(void *base, size_t n, size_t size, SortCompareT cmp,
+	size_t k);
+
+/*
+ * Sorts n int32s on up to threads threads with a work-stealing pool, see
+ * ParallelMergeSort.c.  If it can't get a buffer of n ints it sorts with
+ * pdq_sort instead.
+ */
+void parallel_merge_sort_int32(int32_t *arr, size_t n, unsigned threads);
+
+/*
+ * The SIMD kernels behind merge_sort_int32, see SimdSort.c.  They use AVX2
+ * when the CPU has it and plain C otherwise, picked once on the first call;
+ * SORT_KERNELS=scalar|avx2 in the environment forces one of them and
+ * sort_kernels names the one in use.  sort_block_int32 sorts n ints
+ * where n is at most SORT_BLOCK_SIZE.  merge_int32 merges the sorted runs
+ * left[0, l_n) and right[0, r_n) into out, which must not overlap them.
+ */
+#define SORT_BLOCK_SIZE 64
+char const *sort_kernels(void);
+void sort_block_int32(int32_t *arr, size_t n);
+void merge_int32(int32_t const *left, size_t l_n, int32_t const *right,
+	size_t r_n, int32_t *out);
+
+/* merge_sort_int32 with the caller's n ints at buffer as scratch space. */
+void merge_sort_int32_buffer(int32_t *arr, int32_t *buffer, size_t n);
+
+/*
+ * Sorts the int32s read from in_fd until end of file and writes them to
+ * out_fd, for inputs too big for memory, see ExternalSort.c.  The buffers
+ * never take more than memory bytes (at least EXTERNAL_MIN_MEMORY are used).
+ * Temporary files go in temp_dir, or $TMPDIR or /tmp if it is NULL.  Returns
+ * 1 on success, 0 otherwise.
+ */
+#define EXTERNAL_MIN_MEMORY (1 << 20)
+int external_sort_int32(int in_fd, int out_fd, size_t memory,
+	char const *temp_dir);
+
+/*
+ * LSD radix sorts for integer and floating point keys, see RadixSort.c.
+ * The _payload versions move the n elements of size bytes at payload along
+ * with their keys.  Stable.  They return 0 and leave the arrays untouched if
+ * their buffers could not be allocated, 1 otherwise.
+ */
+#define RADIX_DECLARE(name, type)                                            \
+int radix_sort_##name(type *keys, size_t n);                                 \
+int radix_sort_##name##_payload(type *keys, void *payload, size_t size,     \
+	size_t n);
+
+RADIX_DECLARE(uint32, uint32_t)
+RADIX_DECLARE(int32, int32_t)
+RADIX_DECLARE(float, float)
+RADIX_DECLARE(uint64, uint64_t)
+RADIX_DECLARE(int64, int64_t)
+RADIX_DECLARE(double, double)
+
+/*
+ * SORT_DEFINE defines insertion_sort_name, selection_sort_name and
+ * merge_sort_name for arrays of type, with less(a, b) inlined as the order.
+ * less takes two values and is true if a goes before b, e.g.
+ *
+ *   #define LESS(a, b) ((a) < (b))
+ *   SORT_DEFINE(int32, int32_t, LESS)
+ *
+ * They work just like the generic sorts, without the size and cmp arguments.
+ */
+#define SORT_DEFINE(name, type, less)                                        \
+SORT_DEFINE_SIMPLE(name, type, less)                                         \
+SORT_DEFINE_MERGE(name, type, less)
+
+/*
+ * SORT_DEFINE_SIMPLE defines only insertion_sort_name and selection_sort_name,
+ * for types whose merge sort is written by hand, like int32 in SimdSort.c.
+ */
+#define SORT_DEFINE_SIMPLE(name, type, less)                                 \
+void insertion_sort_##name(type *arr, size_t n)                              \
+{                                                                            \
+	size_t i, j;                                                         \
+	type key;                                                            \
+                                                                             \
+	for (i = 1; i < n; ++i) {                                            \
+		key = arr[i];                                                \
+		for (j = i; j > 0 && less(key, arr[j - 1]); --j)             \
+			arr[j] = arr[j - 1];                                 \
+		arr[j] = key;                                                \
+	}                                                                    \
+}                                                                            \
+                                                                             \
+void selection_sort_##name(type *arr, size_t n)                              \
+{                                                                            \
+	size_t i, j, smallest;                                               \
+	type temp;                                                           \
+                                                                             \
+	for (i = 0; i + 1 < n; ++i) {                                        \
+		smallest = i;                                                \
+		for (j = i + 1; j < n; ++j) {                                \
+			if (less(arr[j], arr[smallest]))                     \
+				smallest = j;                                \
+		}                                                            \
+		temp = arr[i];                                               \
+		arr[i] = arr[smallest];                                      \
+		arr[smallest] = temp;                                        \
+	}                                                                    \
+}
+
+/*
+ * SORT_DEFINE_MERGE defines only merge_sort_name.  It insertion sorts the runs
+ * it starts with using insertion_sort_name.
+ */
+#define SORT_DEFINE_MERGE(name, type, less)                                  \
+static void merge_##name(type const *l_iter, type const *l_end,              \
+	type const *r_iter, type const *r_end, type *out)                    \
+{                                                                            \
+	if (l_iter == l_end || r_iter == r_end || !less(*r_iter, l_end[-1])) { \
+		memcpy(out, l_iter, sizeof(type) * (l_end - l_iter));        \
+		memcpy(out + (l_end - l_iter), r_iter,                       \
+			sizeof(type) * (r_end - r_iter));                    \
+		return;                                                      \
+	}                                                                    \
+	while (l_iter < l_end && r_iter < r_end) {                           \
+		if (less(*r_iter, *l_iter))                                  \
+			*out++ = *r_iter++;                                  \
+		else                                                         \
+			*out++ = *l_iter++;                                  \
+	}                                                                    \
+	while (l_iter < l_end)                                               \
+		*out++ = *l_iter++;                                          \
+	while (r_iter < r_end)                                               \
+		*out++ = *r_iter++;                                          \
+}                                                                            \
+                                                                             \
+int merge_sort_##name(type *arr, size_t n)                                   \
+{                                                                            \
+	size_t width, i, middle, last;                                       \
+	type *from = arr;                                                    \
+	type *to;                                                            \
+	type *buffer;                                                        \
+	type *temp;                                                          \
+                                                                             \
+	if (n <= SORT_RUN_SIZE) {                                            \
+		insertion_sort_##name(arr, n);                               \
+		return 1;                                                    \
+	}                                                                    \
+                                                                             \
+	to = buffer = malloc(sizeof(type) * n);                              \
+	if (!buffer)                                                         \
+		return 0;                                                    \
+	for (i = 0; i < n; i += SORT_RUN_SIZE)                               \
+		insertion_sort_##name(arr + i,                               \
+			i + SORT_RUN_SIZE < n ? SORT_RUN_SIZE : n - i);      \
+	for (width = SORT_RUN_SIZE; width < n; width *= 2) {                 \
+		for (i = 0; i < n; i += 2 * width) {                         \
+			middle = i + width < n ? i + width : n;              \
+			last = i + 2 * width < n ? i + 2 * width : n;        \
+			merge_##name(from + i, from + middle,                \
+				from + middle, from + last, to + i);         \
+		}                                                            \
+		temp = from;                                                 \
+		from = to;                                                   \
+		to = temp;                                                   \
+	}                                                                    \
+	if (from != arr)                                                     \
+		memcpy(arr, from, sizeof(type) * n);                         \
+	free(buffer);                                                        \
+	return 1;                                                            \
+}
+
+/* Declares the functions SORT_DEFINE(name, type, less) defines. */
+#define SORT_DECLARE(name, type)                                             \
+void insertion_sort_##name(type *arr, size_t n);                             \
+void selection_sort_##name(type *arr, size_t n);                             \
+int merge_sort_##name(type *arr, size_t n);
+
+/* The typed sorts defined by the library. */
+SORT_DECLARE(int32, int32_t)
+SORT_DECLARE(int64, int64_t)
+SORT_DECLARE(double, double)
+SORT_DECLARE(string, char const*)
+
+#endif
@@ -0,0 +1,431 @@
+/*
+ * file: compact-list.c
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "sorted-list.h"
+#define SUCCESS 1
+
+/* Set in the prev index of a node once it has been removed. */
+#define REMOVED 0x80000000u
+
+/* Number of nodes a new list has room for. */
+#define MIN_NODES 16
+
+/* Runs in O(1) time.
+ * A helper function that returns what the list hands out for a node: the
+ * pointer it holds, or a pointer to its key for a list of inline keys.
+ */
+static void *nodeValue ( CompactStore *store, SLIndex i ) {
+  return store->key_size ? (void *) store->nodes[i].item.key
+                         : store->nodes[i].item.value;
+}
+
+/* Runs in O(1) time.
+ * A helper function that allocates a store with room for capacity nodes.
+ *
+ * returns the store, NULL if malloc failed.
+ */
+static CompactStore *allocStore ( CompactStore *old, SLIndex capacity ) {
+  return realloc( old, offsetof( CompactStore, nodes ) +
+      (size_t) capacity * sizeof(CompactNode) );
+}
+
+/* Runs in O(n) time where n is the number of pending nodes.
+ * A helper function that hands the nodes removed while iterators were alive
+ * over to the free chain, once no iterator can be standing on them.
+ */
+static void releasePending ( CompactStore *store ) {
+  SLIndex i = store->pending;
+
+  while ( i != SL_NONE ) {
+    SLIndex next = store->nodes[i].prev & ~REMOVED;
+    store->nodes[i].next = store->free;
+    store->nodes[i].prev = REMOVED | SL_NONE;
+    store->free = i;
+    i = next;
+  }
+  store->pending = SL_NONE;
+}
+
+/* Runs in O(1) time.
+ * A helper function that checks an index read from an image: it has to be
+ * the end of a chain or one of the used nodes.
+ */
+static int validIndex ( CompactStore const *store, SLIndex i ) {
+  return i == SL_NONE || i < store->used;
+}
+
+/* Runs in O(n) time.
+ * A helper function that checks that an image can be trusted before anything
+ * follows its indices: every index points at a used node, the list runs from
+ * head to tail over size nodes linked both ways, and the free and pending
+ * chains end without looping and hold only removed nodes.
+ *
+ * returns 1 if the store is consistent, 0 otherwise.
+ */
+static int validStore ( CompactStore const *store ) {
+  SLIndex i, last, count, steps;
+
+  if ( store->key_size > SL_INLINE_SIZE || store->size > store->used ||
+       !validIndex( store, store->head ) || !validIndex( store, store->tail ) ||
+       !validIndex( store, store->free ) ||
+       !validIndex( store, store->pending ) ) {
+    return 0;
+  }
+  for ( i = 0; i < store->used; i++ ) {
+    if ( !validIndex( store, store->nodes[i].next ) ||
+         !validIndex( store, store->nodes[i].prev & ~REMOVED ) ) {
+      return 0;
+    }
+  }
+
+  //the list itself, linked both ways
+  for ( i = store->head, last = SL_NONE, count = 0; i != SL_NONE;
+        last = i, i = store->nodes[i].next ) {
+    if ( count++ == store->size || store->nodes[i].prev != last ) {
+      return 0;
+    }
+  }
+  if ( count != store->size || last != store->tail ) {
+    return 0;
+  }
+
+  //the pending chain runs through prev, the free chain through next
+  for ( i = store->pending, steps = 0; i != SL_NONE;
+        i = store->nodes[i].prev & ~REMOVED ) {
+    if ( ++steps > store->used - count ||
+         !( store->nodes[i].prev & REMOVED ) ) {
+      return 0;
+    }
+  }
+  count += steps;
+  for ( i = store->free, steps = 0; i != SL_NONE; i = store->nodes[i].next ) {
+    if ( ++steps > store->used - count ||
+         !( store->nodes[i].prev & REMOVED ) ) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Runs in O(1) time, amortized over the growth of the node array.
+ * A helper function that finds a node for a new object: a removed one if
+ * there is one, else the next one never used, growing the array if it's full.
+ *
+ * returns the index of the node, SL_NONE if the array could not grow.
+ */
+static SLIndex allocNode ( SortedCompactListPtr list ) {
+  CompactStore *store = list->store;
+  SLIndex i = store->free;
+
+  if ( i != SL_NONE ) {
+    store->free = store->nodes[i].next;
+    return i;
+  }
+
+  if ( store->used == store->capacity ) {
+    SLIndex capacity = store->capacity < SL_NONE / 2 ? store->capacity * 2
+                                                     : SL_NONE;
+    if ( capacity == store->capacity ||
+         !( store = allocStore( store, capacity ) ) ) {
+      return SL_NONE;
+    }
+    store->capacity = capacity;
+    list->store = store;
+  }
+  return store->used++;
+}
+
+/* Runs in O(1) time
+ * SLCreateCompact creates a new, empty compact list.
+ *
+ * arg: cf is a comparator function to use to keep the list sorted.
+ * arg: key_size is 0 to keep pointers to the objects, or the size of the keys
+ * to copy into the nodes, at most SL_INLINE_SIZE.
+ *
+ * return: Non-Null SortedCompactListPtr, NULL otherwise.
+ */
+SortedCompactListPtr SLCreateCompact( CompareFuncT cf, size_t key_size ) {
+  SortedCompactListPtr list = malloc( sizeof(SortedCompactList) );
+  CompactStore *store = allocStore( NULL, MIN_NODES );
+
+  //checks to see if what was given to us is valid
+  if ( cf && key_size <= SL_INLINE_SIZE && list && store ) {
+    *store = (CompactStore) { key_size, SL_NONE, SL_NONE, 0, MIN_NODES, 0,
+                              SL_NONE, SL_NONE };
+    *list = (SortedCompactList) { cf, store, 0 };
+    return list;
+  }
+  free( list );
+  free( store );
+  return NULL;
+}
+
+/* Runs in O(1) time
+ * SLDestroyCompact destroys a compact list.  The node array is a single
+ * allocation, so no matter the size of the list this is two calls to free.
+ *
+ * arg: list is a pointer to the compact list to destroy.
+ *
+ * WARNING: IT IS THE END USERS RESPONSIBILITY TO FREE THEIR OBJECTS IN A LIST
+ * OF POINTERS.
+ */
+void SLDestroyCompact( SortedCompactListPtr list ) {
+
+  //checks to see if what was given to us is valid
+  if ( !list ) {
+    return;
+  }
+  free( list->store );
+  free( list );
+}
+
+/* Runs in O(n) time.
+ * SLInsertCompact inserts a given object into a compact list, maintaining the
+ * same order SLInsert does.
+ *
+ * arg: list is a pointer to the compact list for the new object.
+ * arg: newObj is a pointer to the new object, or to the key to copy.
+ *
+ * return: 1 on success, 0 otherwise.
+ */
+int SLInsertCompact( SortedCompactListPtr list, void *newObj ) {
+  CompactStore *store;
+  SLIndex current;
+  SLIndex i;
+
+  //checks to see if what was given to us is valid
+  if ( !list || !newObj || ( i = allocNode( list ) ) == SL_NONE ) {
+    return 0;
+  }
+  store = list->store;
+  if ( store->key_size ) {
+    memcpy( store->nodes[i].item.key, newObj, store->key_size );
+  }
+  else {
+    store->nodes[i].item.value = newObj;
+  }
+
+  //find the node to insert in front of, SL_NONE for the end of the list
+  for ( current = store->head;
+        current != SL_NONE &&
+        list->compare( newObj, nodeValue( store, current ) ) < 0;
+        current = store->nodes[current].next ) { ; /*No Operation*/ }
+
+  store->nodes[i].next = current;
+  store->nodes[i].prev = current != SL_NONE ? store->nodes[current].prev
+                                            : store->tail;
+  if ( store->nodes[i].prev != SL_NONE ) {
+    store->nodes[store->nodes[i].prev].next = i;
+  }
+  else { store->head = i; }
+  if ( current != SL_NONE ) {
+    store->nodes[current].prev = i;
+  }
+  else { store->tail = i; }
+
+  ++store->size;
+  return SUCCESS;
+}
+
+/* Runs in O(n) time.
+ * SLGetCompact removes the first object equal to newObj from a compact list
+ * and returns it.  Its node is recycled by a later insert, right away if no
+ * iterator is alive, else once the last iterator is destroyed, so an iterator
+ * standing on it can still follow its next index.
+ *
+ * arg: list is a pointer to the compact list to remove the object from.
+ * arg: newObj is a pointer to the object to be removed.
+ *
+ * return: void* of the removed object on success, NULL otherwise.
+ */
+void *SLGetCompact( SortedCompactListPtr list, void *newObj ) {
+  CompactStore *store;
+  SLIndex current;
+  int compareTo = -1;
+
+  //checks to see if what was given to us is valid
+  if ( !list || !newObj ) {
+    return NULL;
+  }
+  store = list->store;
+
+  //iterate until we find a match
+  for ( current = store->head;
+        current != SL_NONE && ( compareTo =
+          list->compare( newObj, nodeValue( store, current ) ) ) < 0;
+        current = store->nodes[current].next ) { ;/* No Operation  */ }
+  if ( current == SL_NONE || compareTo ) {
+    return NULL;
+  }
+
+  CompactNode *node = &store->nodes[current];
+  if ( node->prev != SL_NONE ) {
+    store->nodes[node->prev].next = node->next;
+  }
+  else { store->head = node->next; }
+  if ( node->next != SL_NONE ) {
+    store->nodes[node->next].prev = node->prev;
+  }
+  else { store->tail = node->prev; }
+
+  if ( list->iterators ) {
+    node->prev = REMOVED | store->pending;
+    store->pending = current;
+  }
+  else {
+    node->prev = REMOVED | SL_NONE;
+    node->next = store->free;
+    store->free = current;
+  }
+  --store->size;
+  return nodeValue( store, current );
+}
+
+/* Runs in O(1) time.
+ * SLCreateCompactIterator creates an iterator that walks a compact list from
+ * beginning to end using SLNextCompactItem.
+ *
+ * arg: list is the list to walk.
+ *
+ * returns a non-NULL SortedCompactListIteratorPtr, else returns NULL.
+ */
+SortedCompactListIteratorPtr SLCreateCompactIterator(
+    SortedCompactListPtr list ) {
+
+  //checks to see if what was given to us is valid
+  if ( !list || !list->store->size ) {
+    return NULL;
+  }
+
+  SortedCompactListIteratorPtr iter =
+    malloc( sizeof( SortedCompactListIterator ) );
+  if ( iter ) {
+    *iter = (SortedCompactListIterator) { list, list->store->head };
+    ++list->iterators;
+    return iter;
+  }
+  return NULL;
+}
+
+/* Runs in O(1) time, O(n) if it is the last iterator and nodes are pending.
+ * SLDestroyCompactIterator destroys an iterator of a compact list.  When the
+ * last one is gone the nodes removed while it was alive can be reused.
+ *
+ * arg: iter is the iterator to destroy.
+ */
+void SLDestroyCompactIterator( SortedCompactListIteratorPtr iter ) {
+
+  //checks to see if what was given to us is valid
+  if ( !iter ) {
+    return;
+  }
+  if ( !--iter->list->iterators ) {
+    releasePending( iter->list->store );
+  }
+  free( iter );
+}
+
+/* Runs in O(1) time for normal case, but can degrade to O(n).
+ * SLNextCompactItem returns the next object in the list, or NULL when the end
+ * of the list has been reached.  It behaves like SLNextItem: if the node it
+ * stands on has been removed it follows the next indices until it finds one
+ * that hasn't.  Removed nodes are never reused while an iterator is alive, so
+ * those indices still lead back into the list.
+ *
+ * arg: iter is the iterator which will return the next object.
+ * return: Returns a void* to the next object in the list.
+ */
+void *SLNextCompactItem( SortedCompactListIteratorPtr iter ) {
+  CompactStore *store;
+  SLIndex current;
+
+  //checks to see if what was given to us is valid
+  if ( !iter ) {
+    return NULL;
+  }
+  store = iter->list->store;
+
+  //move past removed nodes
+  for ( current = iter->node;
+        current != SL_NONE && ( store->nodes[current].prev & REMOVED );
+        current = store->nodes[current].next ) { ; /*No Operation*/ }
+  if ( current == SL_NONE ) {
+    iter->node = SL_NONE;
+    return NULL;
+  }
+  iter->node = store->nodes[current].next;
+  return nodeValue( store, current );
+}
+
+/* Runs in O(1) time.
+ * SLCompactImage returns the block that holds everything of the list but its
+ * comparator, cut down to the nodes that have been used.
+ *
+ * arg: list is the list to take an image of.
+ * arg: bytes is set to the size of the image.
+ *
+ * return: a pointer to the image, NULL if the list isn't valid.
+ */
+void const *SLCompactImage( SortedCompactListPtr list, size_t *bytes ) {
+
+  //checks to see if what was given to us is valid
+  if ( !list || !bytes ) {
+    return NULL;
+  }
+  *bytes = offsetof( CompactStore, nodes ) +
+    (size_t) list->store->used * sizeof(CompactNode);
+  return list->store;
+}
+
+/* Runs in O(n) time.
+ * SLRestoreCompact creates a compact list out of a copy of an image made by
+ * SLCompactImage.  Nodes that were waiting on iterators when the image was
+ * taken are freed, since none of those iterators came along.  The image is
+ * checked first, so a damaged one is refused instead of followed.
+ *
+ * arg: cf is a comparator function that orders the objects the same way the
+ * one of the list the image was taken of did.
+ * arg: image is the copy of the image.
+ * arg: bytes is the size of the image.
+ *
+ * return: Non-Null SortedCompactListPtr, NULL otherwise.
+ */
+SortedCompactListPtr SLRestoreCompact( CompareFuncT cf, void const *image,
+    size_t bytes ) {
+  CompactStore header;
+  SortedCompactListPtr list;
+
+  //checks to see if what was given to us is valid
+  if ( !cf || !image || bytes < offsetof( CompactStore, nodes ) ) {
+    return NULL;
+  }
+  memcpy( &header, image, offsetof( CompactStore, nodes ) );
+  if ( bytes != offsetof( CompactStore, nodes ) +
+                (size_t) header.used * sizeof(CompactNode) ) {
+    return NULL;
+  }
+
+  list = malloc( sizeof(SortedCompactList) );
+  CompactStore *store = allocStore( NULL, header.used > MIN_NODES
+                                          ? header.used : MIN_NODES );
+  if ( !list || !store ) {
+    free( list );
+    free( store );
+    return NULL;
+  }
+  memcpy( store, image, bytes );
+  if ( !validStore( store ) ) {
+    free( list );
+    free( store );
+    return NULL;
+  }
+  store->capacity = header.used > MIN_NODES ? header.used : MIN_NODES;
+  releasePending( store );
+  *list = (SortedCompactList) { cf, store, 0 };
+  return list;
+}
@@ -155,6 +155,133 @@ void complexIteratorRemoveTest( SortedListPtr sl ){
   SLDestroyIterator(slip3);
 }
 
+void batchIteratorTest( SortedListPtr sl ){
+
+  printf("Batch Iterator Test, 4 at a time\n");
+  SortedListIteratorPtr slip = SLCreateIterator(sl);
+  void *batch[4];
+  size_t count, i;
+
+  while ( ( count = SLNextItems(slip, batch, 4) ) ) {
+    for ( i = 0; i < count; i++ ) {
+      printf("%d ", *(int*) batch[i]);
+    }
+    printf("| ");
+  }
+  printf("\n");
+  SLDestroyIterator(slip);
+  nl();
+}
+
+void priorityQueueTest( void ){
+
+  printf("Priority Queue Test\n");
+  SortedListPtr sl = SLCreate(compareInts);
+  void *batch[3];
+  size_t count, i;
+  int j = 0;
+
+  for(;j<10;j++){
+    SLInsert(sl, &array[j]);
+  }
+  printf("Peek front: %d back: %d\n", *(int*) SLPeekFront(sl),
+      *(int*) SLPeekBack(sl));
+  printf("Pop front: %d\n", *(int*) SLPopFront(sl));
+  printf("Pop back: %d\n", *(int*) SLPopBack(sl));
+
+  count = SLPopFrontN(sl, batch, 3);
+  printf("Pop front 3:");
+  for ( i = 0; i < count; i++ ) {
+    printf(" %d", *(int*) batch[i]);
+  }
+  printf("\n");
+  printSortedList(sl, "Left in the queue");
+  nl();
+  SLDestroy(sl);
+}
+
+void popAfterIteratorRemovalTest( void ){
+
+  printf("Pop After Iterator Removal Test\n");
+  SortedListPtr sl = SLCreate(compareInts);
+  int values[100];
+  void *batch[100];
+  size_t count;
+  int i = 0;
+
+  for(;i<100;i++){
+    values[i] = i;
+    SLInsert(sl, &values[i]);
+  }
+
+  /*Remove the item an iterator stands on, walk past it and let go of it*/
+  SortedListIteratorPtr slip = SLCreateIterator(sl);
+  for(i=0;i<50;i++){
+    SLNextItem(slip);
+  }
+  SLGet(sl, &values[49]);
+  printf("Iterator current item: %d\n", *(int*) SLNextItem(slip));
+  SLDestroyIterator(slip);
+
+  /*Every container should come back as a spare once the list is drained*/
+  count = SLPopFrontN(sl, batch, 100);
+  printf("Popped: %zu Left: %u Spare containers: %u\n", count, sl->size,
+      sl->spares);
+  nl();
+  SLDestroy(sl);
+}
+
+void printCompactList( SortedCompactListPtr sl, char* s ) {
+
+  printf("%s\n", s);
+  SortedCompactListIteratorPtr slip = SLCreateCompactIterator(sl);
+  int *printValue = NULL;
+  while ( ( printValue = (int*) SLNextCompactItem(slip) ) ) {
+    printf("%d ", *printValue);
+  }
+  printf("\n");
+  SLDestroyCompactIterator(slip);
+}
+
+void compactListTest( void ){
+
+  printf("Compact List Test, ints kept inline\n");
+  SortedCompactListPtr sl = SLCreateCompact(compareInts, sizeof(int));
+  int i = 0;
+
+  for(;i<10;i++){
+    SLInsertCompact(sl, &array[i]);
+  }
+  printCompactList(sl, "Creating entire List");
+
+  /*Removing the iterators current item and the one after it*/
+  SortedCompactListIteratorPtr slip = SLCreateCompactIterator(sl);
+  SLNextCompactItem(slip);
+  SLNextCompactItem(slip);
+  SLGetCompact(sl, &array[2]);
+  SLGetCompact(sl, &array[3]);
+  printf("Iterator current item: %d\n", *(int*) SLNextCompactItem(slip));
+
+  /*Snapshot the list while the removed nodes still wait on the iterator*/
+  size_t bytes;
+  void const *image = SLCompactImage(sl, &bytes);
+  void *copy = malloc(bytes);
+  memcpy(copy, image, bytes);
+  SLDestroyCompactIterator(slip);
+  SLDestroyCompact(sl);
+  sl = SLRestoreCompact(compareInts, copy, bytes);
+  printCompactList(sl, "Restored from a snapshot");
+
+  /*A snapshot whose links loop back is refused instead of followed*/
+  CompactStore *damaged = copy;
+  damaged->nodes[damaged->head].next = damaged->head;
+  printf("Damaged snapshot restored: %s\n",
+      SLRestoreCompact(compareInts, copy, bytes) ? "yes" : "no");
+  free(copy);
+  nl();
+  SLDestroyCompact(sl);
+}
+
 int main(void) {
 
   //EMPTY LIST
@@ -175,6 +302,11 @@ int main(void) {
   removeDuplicateTest(sl);
   iteratorRemoveTest(sl);
   complexIteratorRemoveTest(sl);
+  nl();
+  batchIteratorTest(sl);
+  priorityQueueTest();
+  popAfterIteratorRemovalTest();
+  compactListTest();
 
   SLDestroy(sl);
   return EXIT_SUCCESS;
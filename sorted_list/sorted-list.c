@@ -9,6 +9,12 @@
 #include "sorted-list.h"
 #define SUCCESS 1
 
+/* Most containers a list keeps around for reuse. */
+#define MAX_SPARES 1024
+
+/* Number of containers SLNextItems reads ahead of the one it is on. */
+#define LOOK_AHEAD 3
+
 /* Run in O(1) time
  * SLCreate creates a new, empty sorted list.  The caller must provide
  * a comparator function that can be used to order objects that will be
@@ -27,7 +33,7 @@ SortedListPtr SLCreate( CompareFuncT cf ) {
 
   //checks to see if what was given to us is valid
   if ( cf && sorted_list ) {
-    *sorted_list = (SortedList) { cf, NULL, NULL, 0 };
+    *sorted_list = (SortedList) { cf, NULL, NULL, 0, NULL, 0 };
     return sorted_list;
   }
   return NULL;
@@ -52,16 +58,51 @@ void SLDestroy(SortedListPtr list) {
     return;
   }
 
-  Container *container = list->tail->prev;
-  for ( ; container; container = container->prev ) {
-    free ( container->next );
+  Container *container = list->head;
+  Container *next = NULL;
+  for ( ; container; container = next ) {
+    next = container->next;
+    free ( container );
   }
-  if ( list->head ) {
-    free ( list->head );
+  for ( container = list->spare; container; container = next ) {
+    next = container->next;
+    free ( container );
   }
   free(list);
 }
 
+/* Runs in O(1) time.
+ * A helper function that gets a container for a new object, a spare one if
+ * the list has one and a new one otherwise.
+ *
+ * returns a pointer to the container, NULL if malloc failed.
+ */
+static Container *newContainer ( SortedListPtr list ) {
+
+  Container *container = list->spare;
+
+  if ( container ) {
+    list->spare = container->next;
+    --list->spares;
+    return container;
+  }
+  return malloc ( sizeof(Container) );
+}
+
+/* Runs in O(1) time.
+ * A helper function that takes back a container nothing points to any more.
+ * Up to MAX_SPARES of them are kept for newContainer, the rest are freed.
+ */
+static void recycleContainer ( SortedListPtr list, Container *container ) {
+
+  if ( list->spares < MAX_SPARES ) {
+    container->next = list->spare;
+    list->spare = container;
+    ++list->spares;
+  }
+  else { free ( container ); }
+}
+
 /* Runs in O(1) time.
  * A helper function for inserting into an empty list.
  *
@@ -72,7 +113,7 @@ void SLDestroy(SortedListPtr list) {
  */
 int insertEmpty ( SortedListPtr list, void *newObj ) {
 
-  Container *container = malloc ( sizeof(Container) );
+  Container *container = newContainer ( list );
 
   //check to make sure malloc didn't return NULL
   if ( container ) {
@@ -147,7 +188,7 @@ int insertEnd ( SortedListPtr list, void *newObj, Container *container ) {
 int insert ( SortedListPtr list, void *newObj ) {
 
   Container *current;
-  Container *container = malloc ( sizeof(Container) );
+  Container *container = newContainer ( list );
 
   //checks to see if what was given to us is valid and make sure malloc didn't
   //return null
@@ -236,18 +277,38 @@ SortedListIteratorPtr SLCreateIterator(SortedListPtr list) {
   return NULL;
 }
 
-/* Runs in O(1) time.
+/* Runs in O(1) time for normal case, but can degrade to O(n).
  * SLDestroyIterator destroys an iterator object that was created using
- * SLCreateIterator().  And does not effect the list.
+ * SLCreateIterator().  And does not effect the list.  The reference it holds
+ * on the container it stands on is given back, so that container counts as
+ * free of iterators again.  Removed containers left with no reference are
+ * freed along with the reference they held on the container after them.
  *
  * arg: iter is a SortedListIteratorPointer which should be destroyed.
  */
 void SLDestroyIterator(SortedListIteratorPtr iter) {
 
+  Container *current = NULL;
+  Container *next = NULL;
+
   //checks to see if what was given to us is valid
   if ( !iter ) {
     return;
   }
+
+  for ( current = iter->iterator; current; current = next ) {
+    //a container still in the list
+    if ( current->count > 0 ) {
+      --current->count;
+      break;
+    }
+    //a removed container other iterators still stand on
+    if ( ++current->count ) {
+      break;
+    }
+    next = current->next;
+    free ( current );
+  }
   free ( iter );
 }
 
@@ -298,6 +359,9 @@ void *SLNextItem(SortedListIteratorPtr iter) {
       free ( temp );
     } else {
       iter->iterator = iter->iterator->next;
+      //the removed container was the end of the list
+      if ( !iter->iterator )
+        break;
       //if the next container is removed decrement the count away from 0
       if ( iter->iterator->count < 0 )
         --iter->iterator->count;
@@ -325,6 +389,82 @@ void *SLNextItem(SortedListIteratorPtr iter) {
   return iter->iterator->prev->value;
 }
 
+/* Runs in O(max) time for normal case, but can degrade to O(n).
+ * SLNextItems fills out with up to max objects, the same ones max calls to
+ * SLNextItem would return.
+ *
+ * Only the container the iterator stands on can have been removed, a
+ * container that is still in the list never points at a removed one.  So
+ * once that first container is dealt with by SLNextItem the rest of the batch
+ * is a plain walk down the next pointers.  The reference the iterator holds
+ * is moved from the container it started on to the one it stops on at the end
+ * instead of one container at a time.
+ *
+ * A second pointer runs LOOK_AHEAD containers in front of the walk.  Each step
+ * it prefetches the object of the container it is on, which the caller will
+ * read, and then the container after it, whose address it already has.
+ *
+ * arg: iter is a SortListIteratorPtr which will return the next objects.
+ * arg: out is an array of at least max void*.
+ * arg: max is the most objects to return.
+ * return: the number of objects put in out.
+ */
+size_t SLNextItems(SortedListIteratorPtr iter, void **out, size_t max) {
+
+  Container *start = NULL;
+  Container *current = NULL;
+  Container *ahead = NULL;
+  size_t count = 0;
+  unsigned i;
+
+  //checks to see if what was given to us is valid
+  if ( !iter || !iter->iterator || !out || !max ) {
+    return 0;
+  }
+
+  //let SLNextItem move past removed containers
+  if ( iter->iterator->count <= 0 ) {
+    if ( !( out[count] = SLNextItem(iter) ) ) {
+      return 0;
+    }
+    if ( ++count == max || !iter->iterator ) {
+      return count;
+    }
+  }
+
+  start = current = ahead = iter->iterator;
+  for ( i = 0; ahead && i != LOOK_AHEAD; ++i ) {
+    __builtin_prefetch( ahead->value );
+    ahead = ahead->next;
+  }
+  for ( ;; ) {
+    if ( ahead ) {
+      __builtin_prefetch( ahead->value );
+      if ( ( ahead = ahead->next ) ) {
+        __builtin_prefetch( ahead );
+      }
+    }
+    out[count++] = current->value;
+
+    //check for last item in the list
+    if ( !current->next ) {
+      --start->count;
+      iter->iterator = NULL;
+      return count;
+    }
+    current = current->next;
+    if ( count == max ) {
+      break;
+    }
+  }
+
+  //move the reference of the iterator over to where it stopped
+  --start->count;
+  ++current->count;
+  iter->iterator = current;
+  return count;
+}
+
 /*******************************************************************************
  * THESE FUNCTIONS HELP YOU TO NOT LEAK MEMORY AND ARE IN ADDITION TO THE
  * ORIGINAL DEFINED API
@@ -343,24 +483,20 @@ void *SLNextItem(SortedListIteratorPtr iter) {
  */
 void *getValue ( SortedListPtr list, Container *current, int compareTo ) {
 
-  void * ret = current->value;
-
   //make sure current isn't off the EOL and compareTo is 0
   if ( !current || compareTo ) { return NULL; }
 
-  if ( current->prev ) {
-    current->prev->next = current->next;
-    if ( current->count != 2 ) {
-      ++current->next->count;
-    }
-  }
+  void * ret = current->value;
+
+  if ( current->prev ) { current->prev->next = current->next; }
   //handle the front of the list
   else { list->head = current->next; }
 
+  //a container iterators stand on holds on to the one after it for them
   if ( current->next ) {
     current->next->prev = current->prev;
-    if ( current->count != 2) {
-      ++current->prev->count;
+    if ( current->count != 2 ) {
+      ++current->next->count;
     }
   }
   //handle the end of the list
@@ -370,7 +506,7 @@ void *getValue ( SortedListPtr list, Container *current, int compareTo ) {
 
   //free the container if nothing is pointing to it.
   if ( !current->count ) {
-    free ( current );
+    recycleContainer ( list, current );
   }
   else { current->count *= -1; }
 
@@ -431,3 +567,143 @@ void SLDestroyValuesAndList( SortedListPtr list, DestroyFuncT destroy ) {
   SLDestroy( list );
 }
 
+/* Runs in O(1) time.
+ * A helper function for removing the first or the last container of the
+ * list.  A container no iterator stands on is recycled right away.  One that
+ * iterators stand on is left for them the way getValue leaves it, holding on
+ * to the container after it.
+ *
+ * arg: list is a pointer to the SortedList to remove a Container from.
+ * arg: current is the head or the tail of the list.
+ *
+ * returns a void* to the object that was in the container.
+ */
+static void *popContainer ( SortedListPtr list, Container *current ) {
+
+  void *ret = current->value;
+
+  if ( current->prev ) { current->prev->next = current->next; }
+  else { list->head = current->next; }
+  if ( current->next ) { current->next->prev = current->prev; }
+  else { list->tail = current->prev; }
+  --list->size;
+
+  if ( current->count == 2 ) {
+    recycleContainer ( list, current );
+  }
+  else {
+    if ( current->next ) {
+      ++current->next->count;
+    }
+    current->count = 2 - current->count;
+  }
+  return ret;
+}
+
+/* Runs in O(1) time.
+ * SLPeekFront returns the first object in the list without removing it.
+ *
+ * arg: list is a pointer to the SortedList to look at.
+ *
+ * return: void* of the first object, NULL if the list is empty.
+ */
+void *SLPeekFront( SortedListPtr list ) {
+
+  //checks to see if what was given to us is valid
+  if ( !list || !list->head ) {
+    return NULL;
+  }
+  return list->head->value;
+}
+
+/* Runs in O(1) time.
+ * SLPeekBack returns the last object in the list without removing it.
+ *
+ * arg: list is a pointer to the SortedList to look at.
+ *
+ * return: void* of the last object, NULL if the list is empty.
+ */
+void *SLPeekBack( SortedListPtr list ) {
+
+  //checks to see if what was given to us is valid
+  if ( !list || !list->tail ) {
+    return NULL;
+  }
+  return list->tail->value;
+}
+
+/* Runs in O(1) time.
+ * SLPopFront removes the first object in the list and returns it.  Unlike
+ * SLGet it never calls the comparator.
+ *
+ * arg: list is a pointer to the SortedList to remove the object from.
+ *
+ * return: void* of the removed object, NULL if the list is empty.
+ */
+void *SLPopFront( SortedListPtr list ) {
+
+  //checks to see if what was given to us is valid
+  if ( !list || !list->head ) {
+    return NULL;
+  }
+  return popContainer ( list, list->head );
+}
+
+/* Runs in O(1) time.
+ * SLPopBack removes the last object in the list and returns it.
+ *
+ * arg: list is a pointer to the SortedList to remove the object from.
+ *
+ * return: void* of the removed object, NULL if the list is empty.
+ */
+void *SLPopBack( SortedListPtr list ) {
+
+  //checks to see if what was given to us is valid
+  if ( !list || !list->tail ) {
+    return NULL;
+  }
+  return popContainer ( list, list->tail );
+}
+
+/* Runs in O(max) time.
+ * SLPopFrontN drains up to max objects from the front of the list into out,
+ * in list order.  The head is only written back once, after the whole run of
+ * containers no iterator stands on has been taken off.
+ *
+ * arg: list is a pointer to the SortedList to remove the objects from.
+ * arg: out is an array of at least max void*.
+ * arg: max is the most objects to remove.
+ *
+ * return: the number of objects removed.
+ */
+size_t SLPopFrontN( SortedListPtr list, void **out, size_t max ) {
+
+  Container *current = NULL;
+  Container *next = NULL;
+  size_t count = 0;
+
+  //checks to see if what was given to us is valid
+  if ( !list || !out ) {
+    return 0;
+  }
+
+  while ( count < max && list->head ) {
+    //a container an iterator stands on needs the general case
+    if ( list->head->count != 2 ) {
+      out[count++] = popContainer ( list, list->head );
+      continue;
+    }
+    for ( current = list->head;
+          count < max && current && current->count == 2;
+          current = next ) {
+      next = current->next;
+      out[count++] = current->value;
+      recycleContainer ( list, current );
+      --list->size;
+    }
+    list->head = current;
+    if ( current ) { current->prev = NULL; }
+    else { list->tail = NULL; }
+  }
+  return count;
+}
@@ -6,6 +6,7 @@
  * author: Jesse Ziegler (c) holder
  * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
  */
+#include <stdint.h>
 #include <stdlib.h>
 
 /*
@@ -52,12 +53,16 @@ typedef int (*DestroyFuncT)(void *);
  * param: tail is a pointer to the last Container in the list.
  * param: size is an unsigned int that holds the number of containers in the
  * list.
+ * param: spare is a chain, through next, of containers kept for reuse.
+ * param: spares is the number of containers on the spare chain.
  */
 struct SortedList {
   CompareFuncT compare;
   Container *head;
   Container *tail;
   unsigned size;
+  Container *spare;
+  unsigned spares;
 };
 typedef struct SortedList* SortedListPtr;
 typedef struct SortedList SortedList;
@@ -135,6 +140,14 @@ void SLDestroyIterator(SortedListIteratorPtr iter);
  */
 void *SLNextItem(SortedListIteratorPtr iter);
 
+/*
+ * SLNextItems fills out with up to max of the next objects in the list, as if
+ * SLNextItem had been called max times, and returns how many it filled in.
+ * It returns less than max only when the end of the list has been reached.
+ * Reference counts are only touched at the ends of the batch.
+ */
+size_t SLNextItems(SortedListIteratorPtr iter, void **out, size_t max);
+
 /*
  * SLRemove removes a given object from a sorted list.  Sorted ordering
  * should be maintained.
@@ -147,10 +160,189 @@ void *SLNextItem(SortedListIteratorPtr iter);
  */
 void *SLGet(SortedListPtr list, void *newObj);
 
+/*
+ * SLPeekFront and SLPeekBack return the first and the last object of the
+ * list, the first and last ones SLNextItem would return, without removing
+ * them.  They return NULL if the list is empty.
+ */
+void *SLPeekFront(SortedListPtr list);
+void *SLPeekBack(SortedListPtr list);
+
+/*
+ * SLPopFront and SLPopBack remove the first and the last object of the list
+ * in O(1) time and return them, or NULL if the list is empty.  Together with
+ * the peeks they let a list be used as a priority queue.
+ */
+void *SLPopFront(SortedListPtr list);
+void *SLPopBack(SortedListPtr list);
+
+/*
+ * SLPopFrontN removes up to max objects from the front of the list into out,
+ * in order, and returns how many it removed.
+ */
+size_t SLPopFrontN(SortedListPtr list, void **out, size_t max);
+
 /*
  * After calling this function, all the values in the list will have been free
  */
 void SLDestroyValuesAndList( SortedListPtr list, DestroyFuncT destroy );
 
-#endif
+/*******************************************************************************
+ * COMPACT LISTS
+ *
+ * A compact list keeps the same order as a SortedList, but its nodes live in
+ * one growable array and link to each other with 32-bit indices, so a node is
+ * 16 bytes and needs no allocation of its own.  Keys of up to SL_INLINE_SIZE
+ * bytes can be copied into the nodes instead of being pointed at.  See
+ * compact-list.c.
+ ******************************************************************************/
+
+/* Index of a node in a compact list.  SL_NONE marks the end of a chain. */
+typedef uint32_t SLIndex;
+#define SL_NONE 0x7fffffffu
+
+/* Largest key that can be kept inside a node. */
+#define SL_INLINE_SIZE 8
+
+/*
+ * A node of a compact list.
+ * param: item is a pointer to the object held in the list, or the bytes of the
+ * object itself if the list keeps its keys inline.
+ * param: next is the index of the next node.
+ * param: prev is the index of the previous node.  The top bit is set once the
+ * node has been removed from the list.
+ */
+struct CompactNode {
+  union {
+    void *value;
+    unsigned char key[SL_INLINE_SIZE];
+  } item;
+  SLIndex next;
+  SLIndex prev;
+};
+typedef struct CompactNode CompactNode;
+
+/*
+ * Everything a compact list holds except its comparator, in one block of
+ * memory without any pointers into itself, so it can be copied with memcpy.
+ * param: key_size is the size of the inline keys, 0 if nodes hold pointers.
+ * param: head is the index of the first node in the list.
+ * param: tail is the index of the last node in the list.
+ * param: size is the number of nodes in the list.
+ * param: capacity is the number of nodes there is room for.
+ * param: used is the number of nodes that have ever been handed out.
+ * param: free is a chain of removed nodes that can be handed out again.
+ * param: pending is a chain of nodes removed while an iterator was alive,
+ * which are kept out of use until the last iterator is gone.
+ * param: nodes is the node array.
+ */
+struct CompactStore {
+  uint32_t key_size;
+  SLIndex head;
+  SLIndex tail;
+  SLIndex size;
+  SLIndex capacity;
+  SLIndex used;
+  SLIndex free;
+  SLIndex pending;
+  CompactNode nodes[];
+};
+typedef struct CompactStore CompactStore;
+
+/*
+ * Compact sorted list type.
+ * param: compare is a function to compare to objects.
+ * param: store holds the nodes, it moves when the list grows.
+ * param: iterators is the number of iterators alive on the list.
+ */
+struct SortedCompactList {
+  CompareFuncT compare;
+  CompactStore *store;
+  unsigned iterators;
+};
+typedef struct SortedCompactList* SortedCompactListPtr;
+typedef struct SortedCompactList SortedCompactList;
+
+/*
+ * Iterator type for a compact list.
+ * param: list is the list being walked.
+ * param: node is the index of the next node to return.
+ */
+struct SortedCompactListIterator {
+  SortedCompactListPtr list;
+  SLIndex node;
+};
+typedef struct SortedCompactListIterator* SortedCompactListIteratorPtr;
+typedef struct SortedCompactListIterator SortedCompactListIterator;
 
+/*
+ * SLCreateCompact creates a new, empty compact list.  key_size is 0 for a
+ * list of pointers like SortedList, or the size of the keys (at most
+ * SL_INLINE_SIZE) for a list that copies its keys into its nodes.
+ *
+ * If the function succeeds, it returns a non-NULL SortedCompactListPtr.
+ * Else, it returns NULL.
+ */
+SortedCompactListPtr SLCreateCompact(CompareFuncT cf, size_t key_size);
+
+/* SLDestroyCompact destroys a compact list and all of its nodes. */
+void SLDestroyCompact(SortedCompactListPtr list);
+
+/*
+ * SLInsertCompact inserts an object, or copies the key newObj points at, into
+ * a compact list the same way SLInsert does.
+ *
+ * If the function succeeds, it returns 1.  Else, it returns 0.
+ */
+int SLInsertCompact(SortedCompactListPtr list, void *newObj);
+
+/*
+ * SLGetCompact removes the first object equal to newObj from a compact list.
+ *
+ * If the function succeeds, it returns the object removed, for a list of
+ * inline keys a pointer to the key inside its old node which stays valid
+ * until the next insert.  Else, it returns NULL.
+ */
+void *SLGetCompact(SortedCompactListPtr list, void *newObj);
+
+/*
+ * SLCreateCompactIterator creates an iterator that walks a compact list from
+ * beginning to end with SLNextCompactItem.
+ *
+ * If the function succeeds, it returns a non-NULL iterator.  Else, it returns
+ * NULL.
+ */
+SortedCompactListIteratorPtr SLCreateCompactIterator(SortedCompactListPtr list);
+
+/* SLDestroyCompactIterator destroys an iterator of a compact list. */
+void SLDestroyCompactIterator(SortedCompactListIteratorPtr iter);
+
+/*
+ * SLNextCompactItem returns the next object of the list, or NULL at the end.
+ * Objects removed while the iterator is alive are skipped just like
+ * SLNextItem skips them.  For a list of inline keys it returns a pointer to
+ * the key inside its node, which is valid until the next insert.
+ */
+void *SLNextCompactItem(SortedCompactListIteratorPtr iter);
+
+/*
+ * SLCompactImage returns the block of memory that holds everything of a
+ * compact list but its comparator and sets *bytes to its size.  Copying those
+ * bytes anywhere is a complete snapshot of the list, which SLRestoreCompact
+ * turns back into a list.  A list of pointers only makes sense again in the
+ * process the objects live in, a list of inline keys makes sense anywhere.
+ */
+void const *SLCompactImage(SortedCompactListPtr list, size_t *bytes);
+
+/*
+ * SLRestoreCompact creates a compact list from a copy of an image made by
+ * SLCompactImage, ordered by cf.  Images whose indices don't make up a
+ * consistent list are refused.
+ *
+ * If the function succeeds, it returns a non-NULL SortedCompactListPtr.
+ * Else, it returns NULL.
+ */
+SortedCompactListPtr SLRestoreCompact(CompareFuncT cf, void const *image,
+    size_t bytes);
+
+#endif
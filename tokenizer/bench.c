@@ -0,0 +1,282 @@
+/*
+ * file: bench.c
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "tokenizer.h"
+
+/* Number of spans pulled out of the tokenizer at a time. */
+#define BATCH_SIZE 1024
+
+/* The delimiters every corpus is generated with. */
+#define SEPARATORS " \t\n"
+
+/*
+ * The shape of a generated corpus.
+ * param: name is printed in the report.
+ * param: min_token and max_token bound the characters in a token.
+ * param: min_run and max_run bound the delimiters between two tokens.
+ * param: escapes is the percentage of token characters written as escapes.
+ */
+struct Corpus {
+  char const *name;
+  size_t min_token;
+  size_t max_token;
+  size_t min_run;
+  size_t max_run;
+  unsigned escapes;
+};
+
+static struct Corpus const corpora[] = {
+  { "short-dense", 1, 4, 1, 1, 0 },
+  { "long-sparse", 32, 128, 1, 1, 0 },
+  { "delim-runs", 1, 8, 1, 16, 0 },
+  { "escape-free", 4, 16, 1, 2, 0 },
+  { "escape-heavy", 4, 16, 1, 2, 50 }
+};
+
+/* State of the random number generator, fixed so every run sees the same. */
+static unsigned long long seed = 88172645463325252ULL;
+
+/* next_random returns the next number of a xorshift64 generator. */
+static unsigned long long next_random ( void ) {
+  seed ^= seed << 13;
+  seed ^= seed >> 7;
+  seed ^= seed << 17;
+  return seed;
+}
+
+/* random_between returns a random number from low to high, both included. */
+static size_t random_between ( size_t const low, size_t const high ) {
+  return low + next_random() % ( high - low + 1 );
+}
+
+/*
+ * generate makes a corpus of about size bytes with the given shape.  Escapes
+ * are all ones that decode to a letter so they never make a delimiter.
+ *
+ * returns the '\0' terminated corpus, NULL if memory could not be allocated.
+ */
+static char *generate ( struct Corpus const *const corpus, size_t const size ) {
+  static char const letters[] = "abcdefghijklmnopqrstuvwxyz";
+  char *const text = malloc( size + corpus->max_token * 4 + corpus->max_run + 1 );
+  size_t used = 0;
+  size_t i;
+
+  if ( !text ) {
+    return NULL;
+  }
+  while ( used < size ) {
+    size_t const token = random_between( corpus->min_token, corpus->max_token );
+    size_t const run = random_between( corpus->min_run, corpus->max_run );
+    for ( i = 0; i != token; ++i ) {
+      unsigned const letter = next_random() % 26;
+      if ( next_random() % 100 >= corpus->escapes ) {
+        text[used++] = letters[letter];
+      }
+      else if ( next_random() & 1 ) {
+        used += sprintf( text + used, "\\x%02x", 'a' + letter );
+      }
+      else {
+        used += sprintf( text + used, "\\%03o", 'a' + letter );
+      }
+    }
+    for ( i = 0; i != run; ++i ) {
+      text[used++] = SEPARATORS[next_random() % 3];
+    }
+  }
+  text[used] = '\0';
+  return text;
+}
+
+/* now returns the time in seconds on a clock that only moves forward. */
+static double now ( void ) {
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* report prints one line of the report. */
+static void report ( char const *const corpus, char const *const stage,
+    size_t const bytes, size_t const tokens, double const seconds ) {
+  printf( "%-13s %-18s %10.3f GB/s", corpus, stage, bytes / seconds / 1e9 );
+  if ( tokens ) {
+    printf( " %10.2f Mtok/s", tokens / seconds / 1e6 );
+  }
+  printf( "\n" );
+}
+
+/* Ways of pulling the tokens out of a tokenizer that are timed. */
+#define EXTRACT_NEXT_TOKEN 0
+#define EXTRACT_ARENA 1
+#define EXTRACT_BATCH 2
+#define EXTRACT_SCANNER 3
+#define EXTRACT_PARALLEL 4
+
+static char const *const extract_names[] = {
+  "TKGetNextToken", "TKGetNextToken/ar", "TKGetTokens", "TKScan_ws",
+  "TKParallelTok"
+};
+
+/*
+ * extract pulls every token out of tk the given way.
+ *
+ * returns the number of tokens.
+ */
+static size_t extract ( TokenizerT *const tk, int const how,
+    unsigned const threads ) {
+  TokenSpan spans[BATCH_SIZE];
+  ScanFuncT const scan = TKFindScanner( tk );
+  size_t tokens = 0;
+  size_t count;
+  char *token;
+  unsigned nchunks;
+  unsigned i;
+
+  switch ( how ) {
+    case EXTRACT_NEXT_TOKEN:
+      while ( ( token = TKGetNextToken( tk ) ) ) {
+        free( token );
+        ++tokens;
+      }
+      break;
+    case EXTRACT_ARENA:
+      TKUseArena( tk, 0 );
+      while ( TKGetNextToken( tk ) ) {
+        ++tokens;
+      }
+      break;
+    case EXTRACT_BATCH:
+    case EXTRACT_SCANNER:
+      do {
+        count = how == EXTRACT_SCANNER && scan
+          ? scan( tk, spans, BATCH_SIZE )
+          : TKGetTokens( tk, spans, BATCH_SIZE );
+        tokens += count;
+      } while ( count == BATCH_SIZE );
+      break;
+    case EXTRACT_PARALLEL: {
+      TokenChunk *const chunks =
+        TKParallelTokenize( tk, threads, NULL, NULL, &nchunks );
+      for ( i = 0; chunks && i != nchunks; ++i ) {
+        tokens += chunks[i].count;
+      }
+      TKDestroyChunks( chunks, nchunks );
+      break;
+    }
+  }
+  return tokens;
+}
+
+/*
+ * run_corpus times every stage on one corpus and keeps the best of reps runs
+ * of each.
+ *
+ * returns 1 on success, 0 otherwise.
+ */
+static int run_corpus ( struct Corpus const *const corpus, size_t const size,
+    unsigned const reps, unsigned const threads ) {
+  char *const text = generate( corpus, size );
+  size_t const raw = text ? strlen( text ) : 0;
+  char *const copy = malloc( raw + 1 );
+  double best;
+  double start;
+  size_t decoded = 0;
+  size_t tokens = 0;
+  unsigned rep;
+  int how;
+
+  if ( !text || !copy ) {
+    free( text );
+    free( copy );
+    return 0;
+  }
+
+  /* Escape decoding on its own, both the copying and the in place kind. */
+  for ( best = 1e30, rep = 0; rep != reps; ++rep ) {
+    start = now();
+    char *const simple = simplify_string( text );
+    double const seconds = now() - start;
+    best = seconds < best ? seconds : best;
+    free( simple );
+  }
+  report( corpus->name, "simplify_string", raw, 0, best );
+
+  for ( best = 1e30, rep = 0; rep != reps; ++rep ) {
+    memcpy( copy, text, raw + 1 );
+    start = now();
+    decoded = simplify_in_place( copy );
+    double const seconds = now() - start;
+    best = seconds < best ? seconds : best;
+  }
+  report( corpus->name, "simplify_in_place", raw, 0, best );
+
+  for ( best = 1e30, rep = 0; rep != reps; ++rep ) {
+    start = now();
+    TokenizerT *const tk = TKCreate( SEPARATORS, text );
+    double const seconds = now() - start;
+    best = seconds < best ? seconds : best;
+    if ( tk ) {
+      TKDestroy( tk );
+    }
+  }
+  report( corpus->name, "TKCreate", raw, 0, best );
+
+  /* Token extraction, timed apart from creating the tokenizer. */
+  for ( how = EXTRACT_NEXT_TOKEN; how <= EXTRACT_PARALLEL; ++how ) {
+    for ( best = 1e30, rep = 0; rep != reps; ++rep ) {
+      TokenizerT *const tk = TKCreate( SEPARATORS, text );
+      if ( !tk ) {
+        free( text );
+        free( copy );
+        return 0;
+      }
+      start = now();
+      tokens = extract( tk, how, threads );
+      double const seconds = now() - start;
+      best = seconds < best ? seconds : best;
+      TKDestroy( tk );
+    }
+    report( corpus->name, extract_names[how], decoded, tokens, best );
+  }
+
+  free( text );
+  free( copy );
+  return 1;
+}
+
+/*
+ * main runs the benchmark.  It takes up to three optional arguments: the size
+ * of every corpus in MB (default 16), the number of runs to keep the best of
+ * (default 3) and the number of threads for the parallel stage (default one
+ * per online CPU).
+ */
+int main ( int argc, char **argv ) {
+  size_t const size = ( argc > 1 ? strtoul( argv[1], NULL, 10 ) : 16 ) << 20;
+  unsigned const reps = argc > 2 ? strtoul( argv[2], NULL, 10 ) : 3;
+  long const cpus = sysconf( _SC_NPROCESSORS_ONLN );
+  unsigned const threads =
+    argc > 3 ? strtoul( argv[3], NULL, 10 ) : cpus > 0 ? cpus : 1;
+  size_t i;
+
+  if ( !size || !reps ) {
+    printf("Usage: bench [MB per corpus] [runs] [threads]\n");
+    return EXIT_FAILURE;
+  }
+  printf( "%zu MB per corpus, best of %u runs, %u threads, %s kernels\n",
+      size >> 20, reps, threads, TKGetKernels()->name );
+
+  for ( i = 0; i != sizeof( corpora ) / sizeof( corpora[0] ); ++i ) {
+    if ( !run_corpus( &corpora[i], size, reps, threads ) ) {
+      printf("Could not run the %s corpus\n", corpora[i].name);
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,327 @@
+/*
+ * file: count.c
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+
+#include <string.h>
+#include "tokenizer.h"
+
+/* Smallest number of slots a counter starts out with. */
+#define MIN_SLOTS 64
+
+/* Number of spans pulled out of the tokenizer at a time. */
+#define BATCH_SIZE 1024
+
+/*
+ * hash_token hashes the characters of a token with 64 bit FNV-1a.
+ */
+static size_t hash_token ( char const *const token, size_t const length ) {
+  unsigned long long hash = 14695981039346656037ULL;
+  size_t i;
+
+  for ( i = 0; i != length; ++i ) {
+    hash ^= (unsigned char) token[i];
+    hash *= 1099511628211ULL;
+  }
+  return (size_t) hash;
+}
+
+/*
+ * find_slot returns the slot that holds the token, or the empty slot where it
+ * belongs if it isn't in the table yet.  The table always has an empty slot.
+ */
+static TokenCount *find_slot ( TokenCount *const slots, size_t const mask,
+    char const *const token, size_t const length, size_t const hash ) {
+  size_t i = hash & mask;
+
+  for ( ; slots[i].token; i = ( i + 1 ) & mask ) {
+    if ( slots[i].hash == hash && slots[i].length == length &&
+         !memcmp( slots[i].token, token, length ) ) {
+      break;
+    }
+  }
+  return &slots[i];
+}
+
+/*
+ * grow doubles the number of slots and moves every entry over.  The hashes
+ * stored with the entries are reused so no token is looked at again.
+ *
+ * returns 1 on success, 0 if memory could not be allocated.
+ */
+static int grow ( TKCounterT *const counter ) {
+  size_t const capacity = counter->capacity * 2;
+  TokenCount *const slots = calloc( capacity, sizeof( TokenCount ) );
+  size_t i;
+
+  if ( !slots ) {
+    return 0;
+  }
+  for ( i = 0; i != counter->capacity; ++i ) {
+    TokenCount const *const old = &counter->slots[i];
+    if ( old->token ) {
+      size_t j = old->hash & ( capacity - 1 );
+      for ( ; slots[j].token; j = ( j + 1 ) & ( capacity - 1 ) ) { ; }
+      slots[j] = *old;
+    }
+  }
+  free( counter->slots );
+  counter->slots = slots;
+  counter->capacity = capacity;
+  return 1;
+}
+
+/*
+ * add_token adds times to the count of a token whose hash is already known,
+ * interning the token if it hasn't been seen before.
+ *
+ * returns 1 on success, 0 if memory could not be allocated.
+ */
+static int add_token ( TKCounterT *const counter, char const *const token,
+    size_t const length, size_t const hash, size_t const times ) {
+  TokenCount *slot = find_slot( counter->slots, counter->capacity - 1,
+      token, length, hash );
+
+  if ( !slot->token ) {
+    //keep the table at most 3/4 full so probe runs stay short
+    if ( ( counter->size + 1 ) * 4 > counter->capacity * 3 ) {
+      if ( !grow( counter ) ) {
+        return 0;
+      }
+      slot = find_slot( counter->slots, counter->capacity - 1,
+          token, length, hash );
+    }
+    *slot = (TokenCount) { token, length, hash, 0 };
+    ++counter->size;
+  }
+  slot->count += times;
+  return 1;
+}
+
+/*
+ * TKCreateCounter creates an empty counter.  Tokens are not copied into the
+ * counter, it points at them where they are, so the counted strings must
+ * outlive it.  Memory use only grows with the number of distinct tokens.
+ *
+ * arg: expected is a guess at the number of distinct tokens, may be 0.
+ *
+ * return: a non-NULL TKCounterT on success, NULL otherwise.
+ */
+TKCounterT *TKCreateCounter ( size_t const expected ) {
+  TKCounterT *const counter = malloc( sizeof( TKCounterT ) );
+  size_t capacity = MIN_SLOTS;
+
+  while ( capacity / 4 * 3 < expected ) {
+    capacity *= 2;
+  }
+  TokenCount *const slots = calloc( capacity, sizeof( TokenCount ) );
+
+  if ( counter && slots ) {
+    *counter = (TKCounterT) { slots, capacity, 0 };
+    return counter;
+  }
+  free( counter );
+  free( slots );
+  return NULL;
+}
+
+/*
+ * TKCountToken adds one to the count of a token.
+ *
+ * return: 1 on success, 0 otherwise.
+ */
+int TKCountToken ( TKCounterT *const counter, char const *const token,
+    size_t const length ) {
+  return add_token( counter, token, length, hash_token( token, length ), 1 );
+}
+
+/*
+ * TKCountTokens counts every token left in the token stream in a single pass.
+ *
+ * return: 1 on success, 0 otherwise.
+ */
+int TKCountTokens ( TKCounterT *const counter, TokenizerT *const tk ) {
+  TokenSpan spans[BATCH_SIZE];
+  size_t count;
+  size_t i;
+
+  do {
+    count = TKGetTokens( tk, spans, BATCH_SIZE );
+    for ( i = 0; i != count; ++i ) {
+      if ( !TKCountToken( counter, tk->head + spans[i].offset,
+                          spans[i].length ) ) {
+        return 0;
+      }
+    }
+  } while ( count == BATCH_SIZE );
+  return 1;
+}
+
+/*
+ * TKMergeCounter adds every count of from to into.  This is how the counters
+ * filled in by different threads are put together.
+ *
+ * return: 1 on success, 0 otherwise.
+ */
+int TKMergeCounter ( TKCounterT *const into, TKCounterT const *const from ) {
+  size_t i;
+
+  for ( i = 0; i != from->capacity; ++i ) {
+    TokenCount const *const slot = &from->slots[i];
+    if ( slot->token && !add_token( into, slot->token, slot->length,
+                                    slot->hash, slot->count ) ) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * count_token is the TokenFuncT used by TKParallelCount.  arg is the array of
+ * counters, one per chunk, and the token goes into the one of its chunk.
+ */
+static int count_token ( TokenizerT const *const tk, TokenChunk *const chunk,
+    char const *const token, size_t const length, void *const arg ) {
+  TKCounterT **const counters = arg;
+
+  (void) tk;
+  return TKCountToken( counters[chunk->index], token, length );
+}
+
+/*
+ * TKParallelCount counts every token left in the token stream on up to threads
+ * threads.  Each thread counts the tokens of its chunk straight into a private
+ * counter as it finds them, so no spans are ever recorded and memory only
+ * grows with the distinct tokens.  The private counters are merged into
+ * counter at the end.
+ *
+ * return: 1 on success, 0 otherwise.
+ */
+int TKParallelCount ( TKCounterT *const counter, TokenizerT *const tk,
+    unsigned const threads ) {
+  unsigned const ncounters = threads ? threads : 1;
+  TKCounterT **const counters = calloc( ncounters, sizeof( TKCounterT * ) );
+  TokenChunk *chunks = NULL;
+  unsigned nchunks = 0;
+  unsigned i;
+  int ok = counters != NULL;
+
+  for ( i = 0; ok && i != ncounters; ++i ) {
+    ok = ( counters[i] = TKCreateCounter( 0 ) ) != NULL;
+  }
+  if ( ok ) {
+    chunks = TKParallelVisit( tk, threads, count_token, counters, &nchunks );
+    ok = chunks != NULL;
+  }
+  for ( i = 0; ok && i != nchunks; ++i ) {
+    ok = TKMergeCounter( counter, counters[i] );
+  }
+  for ( i = 0; counters && i != ncounters; ++i ) {
+    TKDestroyCounter( counters[i] );
+  }
+  TKDestroyChunks( chunks, nchunks );
+  free( counters );
+  return ok;
+}
+
+/*
+ * before returns non-zero if a should be listed before b: higher counts come
+ * first and equal counts are listed in byte order of their tokens.
+ */
+static int before ( TokenCount const *const a, TokenCount const *const b ) {
+  size_t const length = a->length < b->length ? a->length : b->length;
+  int order;
+
+  if ( a->count != b->count ) {
+    return a->count > b->count;
+  }
+  order = memcmp( a->token, b->token, length );
+  return order ? order < 0 : a->length < b->length;
+}
+
+/* compare_counts is a qsort comparator that puts counts in listing order. */
+static int compare_counts ( void const *a, void const *b ) {
+  return before( a, b ) ? -1 : before( b, a );
+}
+
+/*
+ * sift_down restores the heap below index i of a heap that keeps the count
+ * that would be listed last on top.
+ */
+static void sift_down ( TokenCount *const heap, size_t const size, size_t i ) {
+  TokenCount const item = heap[i];
+  size_t child;
+
+  for ( ; ( child = 2 * i + 1 ) < size; i = child ) {
+    if ( child + 1 < size && before( &heap[child], &heap[child + 1] ) ) {
+      ++child;
+    }
+    if ( !before( &item, &heap[child] ) ) {
+      break;
+    }
+    heap[i] = heap[child];
+  }
+  heap[i] = item;
+}
+
+/*
+ * TKGetCounts lists the counted tokens, the most frequent first.  When top is
+ * smaller than the number of distinct tokens only the top most frequent are
+ * kept, chosen with a heap of top entries so the rest are never sorted.
+ *
+ * arg: counter is the counter to list.
+ * arg: top is the largest number of tokens to list, 0 for all of them.
+ * arg: count is set to the number of tokens listed.
+ *
+ * return: an array of *count TokenCounts the caller must free, NULL if memory
+ * could not be allocated.
+ */
+TokenCount *TKGetCounts ( TKCounterT const *const counter, size_t top,
+    size_t *const count ) {
+  size_t size = 0;
+  size_t i;
+
+  if ( !top || top > counter->size ) {
+    top = counter->size;
+  }
+  TokenCount *const list = malloc( ( top ? top : 1 ) * sizeof( TokenCount ) );
+  if ( !list ) {
+    return NULL;
+  }
+
+  for ( i = 0; i != counter->capacity; ++i ) {
+    TokenCount const *const slot = &counter->slots[i];
+    if ( !slot->token ) {
+      continue;
+    }
+    if ( size != top ) {
+      list[size++] = *slot;
+      if ( size == top ) {
+        size_t j;
+        for ( j = size / 2; j--; ) {
+          sift_down( list, size, j );
+        }
+      }
+    }
+    else if ( before( slot, &list[0] ) ) {
+      list[0] = *slot;
+      sift_down( list, size, 0 );
+    }
+  }
+
+  qsort( list, size, sizeof( TokenCount ), compare_counts );
+  *count = size;
+  return list;
+}
+
+/* TKDestroyCounter frees a counter.  The counted tokens are not touched. */
+void TKDestroyCounter ( TKCounterT *const counter ) {
+
+  //checks to see if what was given to us is valid
+  if ( !counter ) {
+    return;
+  }
+  free( counter->slots );
+  free( counter );
+}
@@ -0,0 +1,236 @@
+/*
+ * file: kernels.c
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+
+#include <immintrin.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include "tokenizer.h"
+
+/*
+ * The vector kernels are compiled for their instruction set with a target
+ * attribute, so the library itself is built for any x86-64 and only calls
+ * them once the CPU has been checked.  They read whole aligned blocks, which
+ * never cross into the next page, but may read past the '\0' at the end of
+ * the token stream, so they are kept out of AddressSanitizer's sight.
+ */
+#define SSE __attribute__((target("ssse3"), no_sanitize_address))
+#define AVX2 __attribute__((target("avx2"), no_sanitize_address))
+
+/*
+ * find_delim_scalar returns the first delimiter at or after s, going one
+ * character at a time.
+ */
+static char const *find_delim_scalar ( TokenizerT const *const tk,
+    char const *const s ) {
+  unsigned char const *p = (unsigned char const *) s;
+
+  while ( !tk->delim[*p] ) {
+    ++p;
+  }
+  return (char const *) p;
+}
+
+/*
+ * find_token_scalar returns the first character at or after s that isn't a
+ * delimiter, or the '\0' at the end, going one character at a time.
+ */
+static char const *find_token_scalar ( TokenizerT const *const tk,
+    char const *const s ) {
+  unsigned char const *p = (unsigned char const *) s;
+
+  while ( *p && tk->delim[*p] ) {
+    ++p;
+  }
+  return (char const *) p;
+}
+
+/*
+ * delims_sse classifies 16 characters at once: bit i of the result is set when
+ * character i is a delimiter.  The low nibble of a character looks up the high
+ * nibbles it is a delimiter with in tk->nibbles, the high nibble picks its bit
+ * out of that.  Characters of 128 and up find no bit and are never delimiters.
+ */
+SSE static unsigned delims_sse ( __m128i const v, __m128i const nibbles ) {
+  __m128i const low = _mm_set1_epi8( 0x0f );
+  __m128i const bits = _mm_setr_epi8( 1, 2, 4, 8, 16, 32, 64, -128,
+      0, 0, 0, 0, 0, 0, 0, 0 );
+  __m128i const l = _mm_shuffle_epi8( nibbles, _mm_and_si128( v, low ) );
+  __m128i const h = _mm_shuffle_epi8( bits,
+      _mm_and_si128( _mm_srli_epi16( v, 4 ), low ) );
+  __m128i const none = _mm_cmpeq_epi8( _mm_and_si128( l, h ),
+      _mm_setzero_si128() );
+
+  return ~_mm_movemask_epi8( none ) & 0xffff;
+}
+
+/*
+ * find_delim_sse is find_delim_scalar 16 characters at a time.  The first
+ * block is loaded from the aligned address below s and the characters in
+ * front of s are masked off.
+ */
+SSE static char const *find_delim_sse ( TokenizerT const *const tk,
+    char const *const s ) {
+  __m128i const nibbles = _mm_loadu_si128( (__m128i const *) tk->nibbles );
+  unsigned const skip = (uintptr_t) s & 15;
+  char const *p = s - skip;
+  unsigned found = delims_sse( _mm_load_si128( (__m128i const *) p ),
+      nibbles ) >> skip << skip;
+
+  while ( !found ) {
+    p += 16;
+    found = delims_sse( _mm_load_si128( (__m128i const *) p ), nibbles );
+  }
+  return p + __builtin_ctz( found );
+}
+
+/* find_token_sse is find_token_scalar 16 characters at a time. */
+SSE static char const *find_token_sse ( TokenizerT const *const tk,
+    char const *const s ) {
+  __m128i const nibbles = _mm_loadu_si128( (__m128i const *) tk->nibbles );
+  unsigned const skip = (uintptr_t) s & 15;
+  char const *p = s - skip;
+  __m128i v = _mm_load_si128( (__m128i const *) p );
+  unsigned found;
+
+  //a character that isn't a delimiter, or the '\0' which is one
+  found = ( ~delims_sse( v, nibbles ) |
+      _mm_movemask_epi8( _mm_cmpeq_epi8( v, _mm_setzero_si128() ) ) ) &
+    0xffff >> skip << skip;
+  while ( !found ) {
+    p += 16;
+    v = _mm_load_si128( (__m128i const *) p );
+    found = ( ~delims_sse( v, nibbles ) |
+        _mm_movemask_epi8( _mm_cmpeq_epi8( v, _mm_setzero_si128() ) ) ) &
+      0xffff;
+  }
+  return p + __builtin_ctz( found );
+}
+
+/* delims_avx2 is delims_sse for 32 characters. */
+AVX2 static unsigned delims_avx2 ( __m256i const v, __m256i const nibbles ) {
+  __m256i const low = _mm256_set1_epi8( 0x0f );
+  __m256i const bits = _mm256_setr_epi8( 1, 2, 4, 8, 16, 32, 64, -128,
+      0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128,
+      0, 0, 0, 0, 0, 0, 0, 0 );
+  __m256i const l = _mm256_shuffle_epi8( nibbles, _mm256_and_si256( v, low ) );
+  __m256i const h = _mm256_shuffle_epi8( bits,
+      _mm256_and_si256( _mm256_srli_epi16( v, 4 ), low ) );
+  __m256i const none = _mm256_cmpeq_epi8( _mm256_and_si256( l, h ),
+      _mm256_setzero_si256() );
+
+  return ~(unsigned) _mm256_movemask_epi8( none );
+}
+
+/* find_delim_avx2 is find_delim_sse 32 characters at a time. */
+AVX2 static char const *find_delim_avx2 ( TokenizerT const *const tk,
+    char const *const s ) {
+  __m256i const nibbles = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128( (__m128i const *) tk->nibbles ) );
+  unsigned const skip = (uintptr_t) s & 31;
+  char const *p = s - skip;
+  unsigned found = delims_avx2( _mm256_load_si256( (__m256i const *) p ),
+      nibbles ) >> skip << skip;
+
+  while ( !found ) {
+    p += 32;
+    found = delims_avx2( _mm256_load_si256( (__m256i const *) p ), nibbles );
+  }
+  return p + __builtin_ctz( found );
+}
+
+/* find_token_avx2 is find_token_sse 32 characters at a time. */
+AVX2 static char const *find_token_avx2 ( TokenizerT const *const tk,
+    char const *const s ) {
+  __m256i const nibbles = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128( (__m128i const *) tk->nibbles ) );
+  unsigned const skip = (uintptr_t) s & 31;
+  char const *p = s - skip;
+  __m256i v = _mm256_load_si256( (__m256i const *) p );
+  unsigned found;
+
+  //a character that isn't a delimiter, or the '\0' which is one
+  found = ( ~delims_avx2( v, nibbles ) | (unsigned) _mm256_movemask_epi8(
+      _mm256_cmpeq_epi8( v, _mm256_setzero_si256() ) ) ) >> skip << skip;
+  while ( !found ) {
+    p += 32;
+    v = _mm256_load_si256( (__m256i const *) p );
+    found = ~delims_avx2( v, nibbles ) | (unsigned) _mm256_movemask_epi8(
+        _mm256_cmpeq_epi8( v, _mm256_setzero_si256() ) );
+  }
+  return p + __builtin_ctz( found );
+}
+
+/* Every variant of the kernels, the one preferred on a CPU that has it first. */
+static TKKernelsT const kernels[] = {
+  { "avx2", find_delim_avx2, find_token_avx2 },
+  { "sse", find_delim_sse, find_token_sse },
+  { "scalar", find_delim_scalar, find_token_scalar }
+};
+
+#define NKERNELS ( sizeof( kernels ) / sizeof( kernels[0] ) )
+
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+static TKKernelsT const *chosen;
+
+/*
+ * choose_kernels picks the kernels for the CPU the program runs on.  The
+ * TK_KERNELS environment variable can name the variant to use instead, so
+ * they can be timed against each other.  A name the CPU can't run, or that
+ * isn't known, falls back to the best variant the CPU has.
+ */
+static void choose_kernels ( void ) {
+  char const *const forced = getenv( "TK_KERNELS" );
+  int supported[NKERNELS];
+  size_t i;
+
+  __builtin_cpu_init();
+  supported[0] = __builtin_cpu_supports( "avx2" );
+  supported[1] = __builtin_cpu_supports( "ssse3" );
+  supported[2] = 1;
+
+  for ( i = 0; forced && i != NKERNELS; ++i ) {
+    if ( supported[i] && !strcmp( forced, kernels[i].name ) ) {
+      chosen = &kernels[i];
+      return;
+    }
+  }
+  for ( i = 0; !supported[i]; ++i ) { ; }
+  chosen = &kernels[i];
+}
+
+/*
+ * TKGetKernels returns the scanning kernels picked for this CPU.  They are
+ * picked on the first call and never change after that.
+ */
+TKKernelsT const *TKGetKernels ( void ) {
+  pthread_once( &kernels_once, choose_kernels );
+  return chosen;
+}
+
+/*
+ * TKPickKernels sets up the vector form of the delimiter set of tk and points
+ * tk at the kernels that will scan for it.  Only delimiters below 128 fit in
+ * tk->nibbles, a tokenizer with any others gets the scalar kernels.
+ */
+void TKPickKernels ( TokenizerT *const tk ) {
+  TKKernelsT const *picked = TKGetKernels();
+  unsigned c;
+
+  memset( tk->nibbles, 0, sizeof( tk->nibbles ) );
+  for ( c = 0; c != 256; ++c ) {
+    if ( !tk->delim[c] ) {
+      continue;
+    }
+    if ( c >= 128 ) {
+      picked = &kernels[NKERNELS - 1];
+      break;
+    }
+    tk->nibbles[c & 15] |= 1 << ( c >> 4 );
+  }
+  tk->find_delim = picked->find_delim;
+  tk->find_token = picked->find_token;
+}
@@ -0,0 +1,257 @@
+/*
+ * file: main.c
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "tokenizer.h"
+
+/* Number of spans pulled out of the tokenizer at a time. */
+#define BATCH_SIZE 1024
+
+/*
+ * write_chunks writes the tokens of every chunk, chunk by chunk, which puts
+ * them back in their left-to-right order.
+ *
+ * returns 1 on success, 0 otherwise.
+ */
+static int write_chunks ( TKOutputT *const out, TokenizerT const *const tk,
+    TokenChunk const *const chunks, unsigned const nchunks ) {
+  unsigned i;
+
+  for ( i = 0; i != nchunks; ++i ) {
+    if ( !TKWriteSpans( out, tk->head, chunks[i].spans, chunks[i].count ) ) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * write_tokens writes the rest of the token stream a batch of spans at a
+ * time.  A scanner specialized for the delimiters is used if there is one,
+ * unless the CPU has vector kernels, which beat it.
+ *
+ * returns 1 on success, 0 otherwise.
+ */
+static int write_tokens ( TKOutputT *const out, TokenizerT *const tk ) {
+  ScanFuncT const scan =
+    strcmp( TKGetKernels()->name, "scalar" ) ? NULL : TKFindScanner( tk );
+  TokenSpan spans[BATCH_SIZE];
+  size_t count;
+
+  do {
+    count = scan ? scan( tk, spans, BATCH_SIZE )
+                 : TKGetTokens( tk, spans, BATCH_SIZE );
+    if ( !TKWriteSpans( out, tk->head, spans, count ) ) {
+      return 0;
+    }
+  } while ( count == BATCH_SIZE );
+  return 1;
+}
+
+/*
+ * write_counts counts the rest of the token stream and writes the top most
+ * frequent tokens (all of them if top is 0) with their counts, the way
+ * "sort | uniq -c | sort -rn" would.  Each count and its token go to the
+ * output as one token, so they are ended the way the output format says.
+ *
+ * returns 1 on success, 0 otherwise.
+ */
+static int write_counts ( TKOutputT *const out, TokenizerT *const tk,
+    unsigned const threads, size_t const top ) {
+  TKCounterT *const counter = TKCreateCounter( 0 );
+  TokenCount *list;
+  char *line = NULL;
+  size_t capacity = 0;
+  size_t count;
+  size_t i;
+  int ok = 1;
+
+  if ( !counter ) {
+    return 0;
+  }
+  if ( !( threads ? TKParallelCount( counter, tk, threads )
+                  : TKCountTokens( counter, tk ) ) ||
+       !( list = TKGetCounts( counter, top, &count ) ) ) {
+    TKDestroyCounter( counter );
+    return 0;
+  }
+
+  for ( i = 0; ok && i != count; ++i ) {
+    //room for the widest count, the space and the '\0' snprintf adds
+    size_t const size = list[i].length + 3 * sizeof( size_t ) + 2;
+    if ( size > capacity ) {
+      char *const grown = realloc( line, size );
+      if ( !grown ) {
+        ok = 0;
+        break;
+      }
+      line = grown;
+      capacity = size;
+    }
+    int const prefix = snprintf( line, capacity, "%7zu ", list[i].count );
+    memcpy( line + prefix, list[i].token, list[i].length );
+    ok = TKWriteToken( out, line, prefix + list[i].length );
+  }
+  free( line );
+  free( list );
+  TKDestroyCounter( counter );
+  return ok;
+}
+
+/*
+ * write_unique writes every distinct token of the rest of the token stream
+ * once, in byte order, the way "sort -u" would.  The tokens are deduplicated
+ * where they lie by counting them and only the distinct ones are sorted.
+ *
+ * returns 1 on success, 0 otherwise.
+ */
+static int write_unique ( TKOutputT *const out, TokenizerT *const tk,
+    unsigned const threads ) {
+  TKCounterT *const counter = TKCreateCounter( 0 );
+  TokenCount *list;
+  size_t count;
+  size_t i;
+  int ok = 1;
+
+  if ( !counter ) {
+    return 0;
+  }
+  if ( !( threads ? TKParallelCount( counter, tk, threads )
+                  : TKCountTokens( counter, tk ) ) ||
+       !( list = TKGetSortedCounts( counter, threads, &count ) ) ) {
+    TKDestroyCounter( counter );
+    return 0;
+  }
+
+  for ( i = 0; ok && i != count; ++i ) {
+    ok = TKWriteToken( out, list[i].token, list[i].length );
+  }
+  free( list );
+  TKDestroyCounter( counter );
+  return ok;
+}
+
+/*
+ * main will have two string arguments (in argv[1] and argv[2]).
+ * The first string conatins the seperator characters.
+ * The second string contains the tokens.
+ * Print out the tokens in the second string in left-to-right order.
+ * Each token should be printed on a separate line.
+ *
+ * The two strings may be preceded by options:
+ *   -j N  tokenize on N threads.
+ *   -0    end every token with a '\0' instead of a newline.
+ *   -b    write every token after its length as 8 little endian bytes.
+ *   --count   print every distinct token once with the number of times it
+ *             was seen, most frequent first.
+ *   --top N   like --count, but only for the N most frequent tokens.
+ *   --sorted-unique   print every distinct token once, in byte order.  It
+ *             can't be combined with --count or --top.
+ */
+int main ( int argc, char **argv ) {
+  unsigned threads = 0;
+  int format = TK_OUTPUT_LINES;
+  int count = 0;
+  int unique = 0;
+  size_t top = 0;
+  int ok;
+
+  for ( ; argc > 3; --argc, ++argv ) {
+    if ( !strcmp( argv[1], "-j" ) ) {
+      threads = strtoul( argv[2], NULL, 10 );
+      --argc;
+      ++argv;
+    }
+    else if ( !strcmp( argv[1], "-0" ) ) {
+      format = TK_OUTPUT_NUL;
+    }
+    else if ( !strcmp( argv[1], "-b" ) ) {
+      format = TK_OUTPUT_BINARY;
+    }
+    else if ( !strcmp( argv[1], "--count" ) ) {
+      count = 1;
+    }
+    else if ( !strcmp( argv[1], "--sorted-unique" ) ) {
+      unique = 1;
+    }
+    else if ( !strcmp( argv[1], "--top" ) ) {
+      count = 1;
+      top = strtoul( argv[2], NULL, 10 );
+      --argc;
+      ++argv;
+    }
+    else {
+      break;
+    }
+  }
+
+  /*
+   * Checks to make sure that we have the right amount of args and if
+   * the right amount of args have been supplied, try to create a
+   * TokenizerT.  Otherwise it fails and exits.
+   */
+  if ( argc != 3 ) {
+    printf("Incorrect number of arguments\n");
+    return EXIT_FAILURE;
+  }
+  if ( count && unique ) {
+    printf("--sorted-unique can't be combined with --count or --top\n");
+    return EXIT_FAILURE;
+  }
+  TokenizerT *const tk = TKCreate( argv[1], argv[2] );
+  if ( !tk ) {
+    printf("Could not create tokenizer\n");
+    return EXIT_FAILURE;
+  }
+
+  TKOutputT *const out = TKCreateOutput( STDOUT_FILENO, format, 0 );
+  if ( !out ) {
+    printf("Could not create output\n");
+    TKDestroy(tk);
+    return EXIT_FAILURE;
+  }
+
+  if ( count ) {
+    if ( !write_counts( out, tk, threads, top ) ) {
+      printf("Could not count tokens\n");
+      TKDestroyOutput(out);
+      TKDestroy(tk);
+      return EXIT_FAILURE;
+    }
+  }
+  else if ( unique ) {
+    if ( !write_unique( out, tk, threads ) ) {
+      printf("Could not sort tokens\n");
+      TKDestroyOutput(out);
+      TKDestroy(tk);
+      return EXIT_FAILURE;
+    }
+  }
+  else if ( threads ) {
+    unsigned nchunks;
+    TokenChunk *const chunks =
+      TKParallelTokenize( tk, threads, NULL, NULL, &nchunks );
+    if ( !chunks ) {
+      printf("Could not tokenize in parallel\n");
+      TKDestroyOutput(out);
+      TKDestroy(tk);
+      return EXIT_FAILURE;
+    }
+    write_chunks( out, tk, chunks, nchunks );
+    TKDestroyChunks( chunks, nchunks );
+  }
+
+  /* Iterates over the tokens and writes them out */
+  write_tokens( out, tk );
+
+  /* Cleanup and finish. */
+  ok = TKDestroyOutput(out);
+  TKDestroy(tk);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
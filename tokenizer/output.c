@@ -0,0 +1,190 @@
+/*
+ * file: output.c
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "tokenizer.h"
+
+/* Size of the buffer when the caller doesn't pick one. */
+#define DEFAULT_OUTPUT_SIZE ( 1 << 20 )
+
+/*
+ * Tokens at least this big are handed to writev straight out of the token
+ * stream instead of being copied through the buffer.
+ */
+#define DIRECT_WRITE_SIZE ( 1 << 12 )
+
+/*
+ * write_fully writes every byte described by iov to fd, picking up after short
+ * writes and interrupted calls.  iov is used as scratch space.
+ *
+ * returns 1 on success, 0 otherwise.
+ */
+static int write_fully ( int const fd, struct iovec *iov, int count ) {
+  ssize_t written;
+
+  while ( count ) {
+    if ( ( written = writev( fd, iov, count ) ) < 0 ) {
+      if ( errno == EINTR ) {
+        continue;
+      }
+      return 0;
+    }
+    //drop the pieces that are done and trim the one that was cut short
+    for ( ; count && (size_t) written >= iov->iov_len; ++iov, --count ) {
+      written -= iov->iov_len;
+    }
+    if ( count ) {
+      iov->iov_base = (char *) iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
+  return 1;
+}
+
+/*
+ * make_prefix fills prefix with whatever has to be written in front of a
+ * token of the given length: the length as 8 little endian bytes for binary
+ * output, nothing otherwise.
+ *
+ * returns the number of prefix bytes.
+ */
+static size_t make_prefix ( TKOutputT const *const out,
+    unsigned char *const prefix, size_t length ) {
+  size_t i;
+
+  if ( out->format != TK_OUTPUT_BINARY ) {
+    return 0;
+  }
+  for ( i = 0; i != sizeof( uint64_t ); ++i, length >>= 8 ) {
+    prefix[i] = length & 0xff;
+  }
+  return sizeof( uint64_t );
+}
+
+/*
+ * TKCreateOutput creates an output stage that writes tokens to fd.
+ *
+ * arg: fd is the file descriptor to write to, it is not closed by the stage.
+ * arg: format is one of TK_OUTPUT_LINES (a '\n' after every token),
+ * TK_OUTPUT_NUL (a '\0' after every token) or TK_OUTPUT_BINARY (every token is
+ * preceded by its length as 8 little endian bytes).
+ * arg: size is the size of the buffer in bytes, 0 picks a default.
+ *
+ * return: a non-NULL TKOutputT on success, NULL otherwise.
+ */
+TKOutputT *TKCreateOutput ( int const fd, int const format, size_t size ) {
+  TKOutputT *const out = malloc( sizeof( TKOutputT ) );
+
+  if ( !size ) {
+    size = DEFAULT_OUTPUT_SIZE;
+  }
+  char *const buffer = malloc( size );
+
+  if ( out && buffer ) {
+    *out = (TKOutputT) { fd, format, buffer, 0, size, 0 };
+    return out;
+  }
+  free( out );
+  free( buffer );
+  return NULL;
+}
+
+/*
+ * TKFlushOutput writes everything in the buffer to the file descriptor.
+ *
+ * return: 1 on success, 0 if this or any earlier write failed.
+ */
+int TKFlushOutput ( TKOutputT *const out ) {
+  struct iovec iov = { out->buffer, out->used };
+
+  if ( out->used && !out->failed ) {
+    out->failed = !write_fully( out->fd, &iov, 1 );
+  }
+  out->used = 0;
+  return !out->failed;
+}
+
+/*
+ * TKWriteToken adds one token to the output.  Small tokens are copied into the
+ * buffer, which is only written out once it is full.  Big tokens go out
+ * together with the buffer in one writev without being copied.
+ *
+ * return: 1 on success, 0 if this or any earlier write failed.
+ */
+int TKWriteToken ( TKOutputT *const out, char const *const token,
+    size_t const length ) {
+  unsigned char prefix[sizeof( uint64_t )];
+  size_t const prefix_length = make_prefix( out, prefix, length );
+  char const separator = out->format == TK_OUTPUT_NUL ? '\0' : '\n';
+  size_t const separator_length = out->format == TK_OUTPUT_BINARY ? 0 : 1;
+  size_t const total = prefix_length + length + separator_length;
+
+  if ( out->failed ) {
+    return 0;
+  }
+
+  if ( length >= DIRECT_WRITE_SIZE || total > out->capacity ) {
+    struct iovec iov[4] = {
+      { out->buffer, out->used },
+      { prefix, prefix_length },
+      { (char *) token, length },
+      { (char *) &separator, separator_length }
+    };
+    out->failed = !write_fully( out->fd, iov, 4 );
+    out->used = 0;
+    return !out->failed;
+  }
+
+  if ( out->capacity - out->used < total && !TKFlushOutput( out ) ) {
+    return 0;
+  }
+  memcpy( out->buffer + out->used, prefix, prefix_length );
+  memcpy( out->buffer + out->used + prefix_length, token, length );
+  out->used += total;
+  if ( separator_length ) {
+    out->buffer[out->used - 1] = separator;
+  }
+  return 1;
+}
+
+/*
+ * TKWriteSpans adds count tokens of the token stream head to the output.
+ *
+ * return: 1 on success, 0 if this or any earlier write failed.
+ */
+int TKWriteSpans ( TKOutputT *const out, char const *const head,
+    TokenSpan const *const spans, size_t const count ) {
+  size_t i;
+
+  for ( i = 0; i != count; ++i ) {
+    if ( !TKWriteToken( out, head + spans[i].offset, spans[i].length ) ) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * TKDestroyOutput flushes the output and frees it.
+ *
+ * return: 1 if everything was written, 0 otherwise.
+ */
+int TKDestroyOutput ( TKOutputT *const out ) {
+  int ret;
+
+  //checks to see if what was given to us is valid
+  if ( !out ) {
+    return 0;
+  }
+  ret = TKFlushOutput( out );
+  free( out->buffer );
+  free( out );
+  return ret;
+}
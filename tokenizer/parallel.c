@@ -0,0 +1,262 @@
+/*
+ * file: parallel.c
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include "tokenizer.h"
+
+/*
+ * Ranges smaller than this are not worth a thread of their own, the thread
+ * start up would cost more than the tokenizing.
+ */
+#define MIN_CHUNK_SIZE ( 1 << 16 )
+
+/* Everything a worker thread needs to tokenize its chunk. */
+struct ChunkJob {
+  TokenizerT const *tk;
+  TokenChunk *chunk;
+  ChunkFuncT func;
+  TokenFuncT visit;
+  void *arg;
+  pthread_t thread;
+  int started;
+  int failed;
+};
+
+/*
+ * is_sepr returns non-zero if c is one of the delimiters.  The ranges handed
+ * to the workers never contain the terminating '\0' so it is not checked for.
+ */
+static int is_sepr ( unsigned char const *const delim, char const c ) {
+  return delim[(unsigned char) c];
+}
+
+/*
+ * push_span appends a span to a chunk, growing the span array as needed.
+ *
+ * returns 1 on success, 0 if memory could not be allocated.
+ */
+static int push_span ( TokenChunk *const chunk, size_t *const capacity,
+    size_t const offset, size_t const length ) {
+
+  if ( chunk->count == *capacity ) {
+    size_t const grow = *capacity ? *capacity * 2 : 64;
+    TokenSpan *const spans = realloc( chunk->spans, grow * sizeof( TokenSpan ) );
+    if ( !spans ) {
+      return 0;
+    }
+    chunk->spans = spans;
+    *capacity = grow;
+  }
+  chunk->spans[chunk->count++] = (TokenSpan) { offset, length };
+  return 1;
+}
+
+/*
+ * tokenize_chunk is the body of a worker thread.  It walks the characters of
+ * its range the same way TKGetNextToken does, but records spans instead of
+ * copying the tokens out, or hands every token to job->visit if there is one.
+ */
+static void *tokenize_chunk ( void *const arg ) {
+  struct ChunkJob *const job = arg;
+  TokenizerT const *const tk = job->tk;
+  TokenChunk *const chunk = job->chunk;
+  char const *const s = tk->head;
+  size_t const end = chunk->end;
+  size_t capacity = 0;
+  size_t i = chunk->begin;
+
+  while ( i != end ) {
+    /*
+     * Move past any delimiters at the front of the token.  A run of them may
+     * carry on into the next range, so the kernel is stopped at the end.
+     */
+    if ( is_sepr( tk->delim, s[i] ) ) {
+      i = tk->find_token( tk, s + i ) - s;
+      if ( i > end ) {
+        i = end;
+      }
+    }
+    if ( i == end ) {
+      break;
+    }
+
+    /*
+     * While it isn't a delimiter keep going.  The end of the range is a
+     * delimiter, so the kernel never runs past it.
+     */
+    size_t const head = i;
+    i = tk->find_delim( tk, s + i ) - s;
+    if ( job->visit
+         ? !job->visit( tk, chunk, s + head, i - head, job->arg )
+         : !push_span( chunk, &capacity, head, i - head ) ) {
+      job->failed = 1;
+      return NULL;
+    }
+    if ( job->visit ) {
+      ++chunk->count;
+    }
+  }
+
+  if ( job->func ) {
+    job->func( job->tk, chunk, job->arg );
+  }
+  return NULL;
+}
+
+/*
+ * run_chunks splits the rest of the token stream into one range per
+ * thread and tokenizes every range on its own thread.  Split points are moved
+ * forward until they land on a delimiter, so a token always belongs to exactly
+ * one chunk and the chunks in index order give back the original token order.
+ * The first chunk is tokenized on the calling thread.
+ *
+ * arg: tk is the tokenizer to consume.
+ * arg: threads is the largest number of chunks to make.
+ * arg: func is run on the worker with every finished chunk, may be NULL.
+ * arg: visit is run on the worker with every token instead of recording its
+ * span, may be NULL.
+ * arg: arg is handed to func and visit untouched.
+ * arg: nchunks is set to the number of chunks returned.
+ *
+ * return: an array of *nchunks TokenChunks on success, NULL otherwise.
+ */
+static TokenChunk *run_chunks (
+    TokenizerT *const tk,
+    unsigned threads,
+    ChunkFuncT func,
+    TokenFuncT visit,
+    void *arg,
+    unsigned *nchunks
+) {
+
+  //checks to see if what was given to us is valid
+  if ( !tk || !nchunks ) {
+    return NULL;
+  }
+
+  char const *const s = tk->head;
+  size_t const begin = tk->tail - tk->head;
+  size_t const length = begin + strlen( tk->tail );
+  size_t const max_threads = ( length - begin ) / MIN_CHUNK_SIZE + 1;
+  unsigned i;
+  int failed = 0;
+
+  if ( !threads ) {
+    threads = 1;
+  }
+  if ( threads > max_threads ) {
+    threads = max_threads;
+  }
+
+  TokenChunk *const chunks = calloc( threads, sizeof( TokenChunk ) );
+  struct ChunkJob *const jobs = calloc( threads, sizeof( struct ChunkJob ) );
+  if ( !chunks || !jobs ) {
+    free( chunks );
+    free( jobs );
+    return NULL;
+  }
+
+  /* Pick the split points and align each one to the next delimiter. */
+  size_t split = begin;
+  for ( i = 0; i != threads; ++i ) {
+    chunks[i].index = i;
+    chunks[i].begin = split;
+    if ( i + 1 == threads ) {
+      split = length;
+    }
+    else {
+      size_t const target = begin + ( length - begin ) / threads * ( i + 1 );
+      if ( split < target ) {
+        split = target;
+      }
+      while ( split != length && !is_sepr( tk->delim, s[split] ) ) {
+        ++split;
+      }
+    }
+    chunks[i].end = split;
+    jobs[i] = (struct ChunkJob) { tk, &chunks[i], func, visit, arg, 0, 0, 0 };
+  }
+
+  /* Chunk 0 stays on this thread, fall back to it if a thread won't start. */
+  for ( i = 1; i != threads; ++i ) {
+    jobs[i].started =
+      !pthread_create( &jobs[i].thread, NULL, tokenize_chunk, &jobs[i] );
+  }
+  tokenize_chunk( &jobs[0] );
+  for ( i = 1; i != threads; ++i ) {
+    if ( jobs[i].started ) {
+      pthread_join( jobs[i].thread, NULL );
+    }
+    else {
+      tokenize_chunk( &jobs[i] );
+    }
+  }
+  for ( i = 0; i != threads; ++i ) {
+    failed |= jobs[i].failed;
+  }
+  free( jobs );
+
+  if ( failed ) {
+    TKDestroyChunks( chunks, threads );
+    return NULL;
+  }
+
+  tk->tail = tk->head + length;
+  *nchunks = threads;
+  return chunks;
+}
+
+/*
+ * TKParallelTokenize tokenizes the rest of the token stream on up to threads
+ * threads, see run_chunks.  Every chunk records the spans of its tokens.
+ *
+ * return: an array of *nchunks TokenChunks on success, NULL otherwise.
+ */
+TokenChunk *TKParallelTokenize (
+    TokenizerT *const tk,
+    unsigned threads,
+    ChunkFuncT func,
+    void *arg,
+    unsigned *nchunks
+) {
+  return run_chunks( tk, threads, func, NULL, arg, nchunks );
+}
+
+/*
+ * TKParallelVisit goes over the rest of the token stream on up to threads
+ * threads, see run_chunks, calling func with every token on the thread that
+ * found it.  No spans are recorded.
+ *
+ * return: an array of *nchunks TokenChunks on success, NULL otherwise.
+ */
+TokenChunk *TKParallelVisit (
+    TokenizerT *const tk,
+    unsigned threads,
+    TokenFuncT func,
+    void *arg,
+    unsigned *nchunks
+) {
+  return run_chunks( tk, threads, NULL, func, arg, nchunks );
+}
+
+/*
+ * TKDestroyChunks frees an array of chunks made by TKParallelTokenize or
+ * TKParallelVisit.  Any data hung off of the chunks by a ChunkFuncT belongs
+ * to the caller.
+ */
+void TKDestroyChunks ( TokenChunk *chunks, unsigned nchunks ) {
+  unsigned i;
+
+  //checks to see if what was given to us is valid
+  if ( !chunks ) {
+    return;
+  }
+  for ( i = 0; i != nchunks; ++i ) {
+    free( chunks[i].spans );
+  }
+  free( chunks );
+}
@@ -0,0 +1,64 @@
+/*
+ * file: scan.c
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+
+#include <string.h>
+#include "tokenizer.h"
+
+/* The specialized scanners for the delimiter sets that we use the most. */
+TK_DEFINE_SCANNER(ws, " \t\n")
+TK_DEFINE_SCANNER(space, " ")
+TK_DEFINE_SCANNER(comma, ",")
+TK_DEFINE_SCANNER(tab, "\t")
+TK_DEFINE_SCANNER(newline, "\n")
+TK_DEFINE_SCANNER(comma_newline, ",\n")
+TK_DEFINE_SCANNER(tab_newline, "\t\n")
+
+/*
+ * A known delimiter set and the scanner specialized for it.
+ * param: sepr is the set of delimiters.
+ * param: scan is the scanner for it.
+ */
+struct KnownScanner {
+  char const *sepr;
+  ScanFuncT scan;
+};
+
+static struct KnownScanner const known_scanners[] = {
+  { " \t\n", TKScan_ws },
+  { " ", TKScan_space },
+  { ",", TKScan_comma },
+  { "\t", TKScan_tab },
+  { "\n", TKScan_newline },
+  { ",\n", TKScan_comma_newline },
+  { "\t\n", TKScan_tab_newline }
+};
+
+/*
+ * TKFindScanner looks for a specialized scanner for the delimiters of tk.  The
+ * delimiters are compared as a set, so the order they were given in and any
+ * repeats don't matter.
+ *
+ * return: the scanner if there is one for this set, NULL otherwise.  It is
+ * called exactly like TKGetTokens.
+ */
+ScanFuncT TKFindScanner ( TokenizerT const *const tk ) {
+  unsigned char delim[256];
+  unsigned char const *s;
+  size_t i;
+
+  for ( i = 0; i != sizeof( known_scanners ) / sizeof( known_scanners[0] );
+        ++i ) {
+    memset( delim, 0, sizeof( delim ) );
+    for ( s = (unsigned char const *) known_scanners[i].sepr; *s; ++s ) {
+      delim[*s] = 1;
+    }
+    delim['\0'] = 1;
+    if ( !memcmp( delim, tk->delim, sizeof( delim ) ) ) {
+      return known_scanners[i].scan;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,245 @@
+/*
+ * file: sorted.c
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include "tokenizer.h"
+
+/*
+ * Lists with fewer tokens than this are sorted on the calling thread, the
+ * thread start up would cost more than the sorting.
+ */
+#define MIN_PARALLEL_SORT ( 1 << 16 )
+
+/* Number of characters of a token cached in front of it as its key. */
+#define PREFIX_SIZE 8
+
+/*
+ * A token being sorted.
+ * param: prefix is the first PREFIX_SIZE characters of the token packed so
+ * that comparing prefixes as numbers compares the characters in byte order.
+ * Shorter tokens are padded with '\0', which no token holds.
+ * param: count is the entry of the token in the counter.
+ */
+struct SortEntry {
+  unsigned long long prefix;
+  TokenCount const *count;
+};
+
+/* The range of the list that one thread sorts and its scratch space. */
+struct SortJob {
+  struct SortEntry *entries;
+  struct SortEntry *scratch;
+  size_t size;
+  pthread_t thread;
+  int started;
+};
+
+/* make_prefix packs the first PREFIX_SIZE characters of a token. */
+static unsigned long long make_prefix ( char const *const token,
+    size_t const length ) {
+  unsigned long long prefix = 0;
+  size_t i;
+
+  for ( i = 0; i != PREFIX_SIZE; ++i ) {
+    prefix = prefix << 8 | ( i < length ? (unsigned char) token[i] : 0 );
+  }
+  return prefix;
+}
+
+/*
+ * compare_entries is a qsort comparator for entries whose prefixes are equal.
+ * Only the characters after the prefix are left to compare.
+ */
+static int compare_entries ( void const *a, void const *b ) {
+  TokenCount const *const x = ( (struct SortEntry const *) a )->count;
+  TokenCount const *const y = ( (struct SortEntry const *) b )->count;
+  size_t const length = x->length < y->length ? x->length : y->length;
+  int order = length > PREFIX_SIZE
+    ? memcmp( x->token + PREFIX_SIZE, y->token + PREFIX_SIZE,
+        length - PREFIX_SIZE )
+    : 0;
+
+  return order ? order : ( x->length > y->length ) - ( x->length < y->length );
+}
+
+/*
+ * sort_entries sorts size entries on the low bytes bytes of their prefixes
+ * with a least significant digit radix sort, then sorts every run of equal
+ * prefixes on the rest of the tokens.  Digits that are the same for
+ * every entry are skipped.  The entries end up back in entries.
+ */
+static void sort_entries ( struct SortEntry *entries,
+    struct SortEntry *scratch, size_t const size, unsigned const bytes ) {
+  struct SortEntry *const first = entries;
+  size_t counts[256];
+  size_t i;
+  size_t j;
+  unsigned shift;
+
+  for ( shift = 0; shift != bytes * 8; shift += 8 ) {
+    memset( counts, 0, sizeof( counts ) );
+    for ( i = 0; i != size; ++i ) {
+      ++counts[entries[i].prefix >> shift & 0xff];
+    }
+    if ( !size || counts[entries[0].prefix >> shift & 0xff] == size ) {
+      continue;
+    }
+    for ( i = 0, j = 0; i != 256; ++i ) {
+      size_t const count = counts[i];
+      counts[i] = j;
+      j += count;
+    }
+    for ( i = 0; i != size; ++i ) {
+      scratch[counts[entries[i].prefix >> shift & 0xff]++] = entries[i];
+    }
+    struct SortEntry *const swap = entries;
+    entries = scratch;
+    scratch = swap;
+  }
+  if ( entries != first ) {
+    memcpy( first, entries, size * sizeof( struct SortEntry ) );
+  }
+
+  //only tokens that share all PREFIX_SIZE characters are left out of order
+  for ( i = 0; i != size; i = j ) {
+    for ( j = i + 1; j != size && first[j].prefix == first[i].prefix; ++j ) {
+      ;
+    }
+    if ( j - i > 1 ) {
+      qsort( first + i, j - i, sizeof( struct SortEntry ), compare_entries );
+    }
+  }
+}
+
+/* sort_job is the body of a sorting thread. */
+static void *sort_job ( void *const arg ) {
+  struct SortJob *const job = arg;
+
+  sort_entries( job->entries, job->scratch, job->size, PREFIX_SIZE );
+  return NULL;
+}
+
+/*
+ * sort_parallel sorts the entries on up to threads threads.  A first pass
+ * splits them on their first character into scratch, then the runs of
+ * characters are handed out to the threads in contiguous groups of about the
+ * same size.  Each thread sorts its group on its own, the first character is
+ * only sorted on again where a group holds more than one.  The first group is
+ * sorted on the calling thread.
+ *
+ * returns scratch, which is where the entries end up.
+ */
+static struct SortEntry *sort_parallel ( struct SortEntry *const entries,
+    struct SortEntry *const scratch, size_t const size, unsigned threads ) {
+  struct SortJob jobs[256];
+  size_t starts[257];
+  size_t next[256];
+  size_t i;
+  size_t j;
+  unsigned njobs = 0;
+
+  if ( threads > 256 ) {
+    threads = 256;
+  }
+  memset( starts, 0, sizeof( starts ) );
+  for ( i = 0; i != size; ++i ) {
+    ++starts[( entries[i].prefix >> 56 ) + 1];
+  }
+  for ( i = 1; i != 257; ++i ) {
+    starts[i] += starts[i - 1];
+  }
+  memcpy( next, starts, sizeof( next ) );
+  for ( i = 0; i != size; ++i ) {
+    scratch[next[entries[i].prefix >> 56]++] = entries[i];
+  }
+
+  //group whole runs of a first character until a group holds its share
+  for ( i = 0; i != 256; i = j ) {
+    size_t const goal = starts[i] + ( size - starts[i] ) / ( threads - njobs );
+    for ( j = i + 1; j != 256 && starts[j] < goal; ++j ) {
+      ;
+    }
+    if ( njobs + 1 == threads ) {
+      j = 256;
+    }
+    jobs[njobs++] = (struct SortJob) { scratch + starts[i],
+      entries + starts[i], starts[j] - starts[i] };
+  }
+
+  for ( i = 1; i != njobs; ++i ) {
+    jobs[i].started =
+      !pthread_create( &jobs[i].thread, NULL, sort_job, &jobs[i] );
+  }
+  sort_job( &jobs[0] );
+  for ( i = 1; i != njobs; ++i ) {
+    if ( jobs[i].started ) {
+      pthread_join( jobs[i].thread, NULL );
+    }
+    else {
+      sort_job( &jobs[i] );
+    }
+  }
+  return scratch;
+}
+
+/*
+ * TKGetSortedCounts lists every counted token once, in byte order, which is
+ * the order "sort -u" would print them in with LC_ALL=C.  The tokens are not
+ * copied: each one is sorted as its first PREFIX_SIZE characters packed into
+ * a number next to a pointer to its counter entry, so nearly all of the work
+ * is a radix sort of the numbers that never follows the pointers.  Only
+ * tokens that share their whole prefix are compared character by character.
+ *
+ * arg: counter is the counter to list.
+ * arg: threads is the largest number of threads to sort on, 0 for one.
+ * arg: count is set to the number of tokens listed.
+ *
+ * return: an array of *count TokenCounts the caller must free, NULL if memory
+ * could not be allocated.
+ */
+TokenCount *TKGetSortedCounts ( TKCounterT const *const counter,
+    unsigned const threads, size_t *const count ) {
+  size_t const size = counter->size;
+  struct SortEntry *const entries =
+    malloc( ( size ? size : 1 ) * sizeof( struct SortEntry ) );
+  struct SortEntry *const scratch =
+    malloc( ( size ? size : 1 ) * sizeof( struct SortEntry ) );
+  TokenCount *const list = malloc( ( size ? size : 1 ) * sizeof( TokenCount ) );
+  struct SortEntry *sorted = entries;
+  size_t used = 0;
+  size_t i;
+
+  if ( !entries || !scratch || !list ) {
+    free( entries );
+    free( scratch );
+    free( list );
+    return NULL;
+  }
+
+  for ( i = 0; i != counter->capacity; ++i ) {
+    TokenCount const *const slot = &counter->slots[i];
+    if ( slot->token ) {
+      entries[used++] = (struct SortEntry) {
+        make_prefix( slot->token, slot->length ), slot };
+    }
+  }
+
+  if ( threads > 1 && size >= MIN_PARALLEL_SORT ) {
+    sorted = sort_parallel( entries, scratch, size, threads );
+  }
+  else {
+    sort_entries( entries, scratch, size, PREFIX_SIZE );
+  }
+
+  for ( i = 0; i != size; ++i ) {
+    list[i] = *sorted[i].count;
+  }
+  free( entries );
+  free( scratch );
+  *count = size;
+  return list;
+}
@@ -0,0 +1,597 @@
+/*
+ * file: test.c
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "tokenizer.h"
+
+/*
+ * collect_spans takes every token left in tk with scan, which is TKGetTokens
+ * or a scanner, a few at a time.
+ *
+ * returns an array of *count spans the caller must free, NULL if memory could
+ * not be allocated.
+ */
+static TokenSpan *collect_spans ( TokenizerT *const tk, ScanFuncT const scan,
+    size_t *const count ) {
+  TokenSpan *spans = NULL;
+  size_t capacity = 0;
+  size_t got;
+
+  *count = 0;
+  do {
+    if ( capacity - *count < 7 ) {
+      TokenSpan *const grown =
+        realloc( spans, ( capacity * 2 + 7 ) * sizeof( TokenSpan ) );
+      if ( !grown ) {
+        free( spans );
+        return NULL;
+      }
+      spans = grown;
+      capacity = capacity * 2 + 7;
+    }
+    got = scan( tk, spans + *count, 7 );
+    *count += got;
+  } while ( got == 7 );
+  return spans;
+}
+
+/*
+ * arena_regrow_test hands out tokens from an arena, resets it and switches to
+ * bigger blocks, then takes a token that would not fit in the old blocks.  The
+ * spare blocks of the old size must not be filled with it.
+ *
+ * returns 1 if the token comes back whole, 0 otherwise.
+ */
+static int arena_regrow_test ( void ) {
+  char stream[128];
+  TokenizerT *tk;
+  char *token;
+  int ok;
+
+  memset( stream, 'b', sizeof( stream ) - 1 );
+  stream[sizeof( stream ) - 1] = '\0';
+  memcpy( stream, "a ", 2 );
+  stream[102] = ' ';
+  if ( !( tk = TKCreate( " ", stream ) ) ) {
+    return 0;
+  }
+
+  TKUseArena( tk, 64 );
+  ok = ( token = TKGetNextToken( tk ) ) && !strcmp( token, "a" );
+  TKResetArena( tk );
+  TKUseArena( tk, 4096 );
+  ok = ok && ( token = TKGetNextToken( tk ) ) && strlen( token ) == 100 &&
+    token[0] == 'b' && token[99] == 'b';
+  TKDestroy( tk );
+  return ok;
+}
+
+/*
+ * parallel_count_test counts a stream that is split into several chunks on
+ * worker threads, which count straight into private counters, and checks the
+ * merged counts against counting the same stream on one thread.  The counted
+ * tokens point into the tokenizers, so those are kept until the end.
+ *
+ * returns 1 if every count matches, 0 otherwise.
+ */
+static int parallel_count_test ( void ) {
+  size_t const length = 1 << 20;
+  char *const stream = malloc( length + 1 );
+  TKCounterT *const one = TKCreateCounter( 0 );
+  TKCounterT *const many = TKCreateCounter( 0 );
+  TokenizerT *tk_one = NULL;
+  TokenizerT *tk_many = NULL;
+  TokenCount *ones = NULL;
+  TokenCount *manys = NULL;
+  size_t nones = 0;
+  size_t nmanys = 0;
+  size_t i;
+  int ok = stream && one && many;
+
+  for ( i = 0; ok && i != length; ++i ) {
+    stream[i] = i % 7 == 6 ? ' ' : 'a' + ( i * 2654435761u >> 13 ) % 4;
+  }
+  if ( ok ) {
+    stream[length] = '\0';
+    ok = ( tk_one = TKCreate( " ", stream ) ) &&
+      ( tk_many = TKCreate( " ", stream ) ) &&
+      TKCountTokens( one, tk_one ) && TKParallelCount( many, tk_many, 4 ) &&
+      ( ones = TKGetSortedCounts( one, 0, &nones ) ) &&
+      ( manys = TKGetSortedCounts( many, 0, &nmanys ) ) &&
+      nones == nmanys && nones > 1;
+  }
+  for ( i = 0; ok && i != nones; ++i ) {
+    ok = ones[i].length == manys[i].length &&
+      ones[i].count == manys[i].count &&
+      !memcmp( ones[i].token, manys[i].token, ones[i].length );
+  }
+  free( ones );
+  free( manys );
+  TKDestroyCounter( one );
+  TKDestroyCounter( many );
+  if ( tk_one ) {
+    TKDestroy( tk_one );
+  }
+  if ( tk_many ) {
+    TKDestroy( tk_many );
+  }
+  free( stream );
+  return ok;
+}
+
+/*
+ * check_kernels runs the kernels picked for tk from every place of the string
+ * s and checks that they stop where one character at a time would.
+ *
+ * returns 1 if they all agree, 0 otherwise.
+ */
+static int check_kernels ( TokenizerT const *const tk, char const *const s ) {
+  char const *p;
+  char const *want;
+
+  for ( p = s; ; ++p ) {
+    for ( want = p; !tk->delim[(unsigned char) *want]; ++want ) { ; }
+    if ( tk->find_delim( tk, p ) != want ) {
+      return 0;
+    }
+    for ( want = p; *want && tk->delim[(unsigned char) *want]; ++want ) { ; }
+    if ( tk->find_token( tk, p ) != want ) {
+      return 0;
+    }
+    if ( !*p ) {
+      return 1;
+    }
+  }
+}
+
+/*
+ * fill_stream writes length characters to s, then the '\0'.  They are drawn
+ * from the delimiter d, its neighbours, plain letters and characters with the
+ * high bit set, so runs of delimiters and of token characters of every
+ * length show up.
+ */
+static void fill_stream ( char *const s, size_t const length,
+    unsigned const d, unsigned *const seed ) {
+  size_t i;
+
+  for ( i = 0; i != length; ++i ) {
+    *seed = *seed * 1103515245 + 12345;
+    switch ( *seed >> 16 & 7 ) {
+      case 0: case 1: case 2: s[i] = (char) d; break;
+      case 3: s[i] = (char) ( d == 255 ? 1 : d + 1 ); break;
+      case 4: s[i] = (char) ( d == 1 ? 255 : d - 1 ); break;
+      case 5: s[i] = (char) ( 0x80 | ( *seed >> 20 & 0x7f ) ); break;
+      default: s[i] = 'a' + ( *seed >> 20 ) % 26; break;
+    }
+  }
+  s[length] = '\0';
+}
+
+/*
+ * kernels_test checks the kernels TK_KERNELS picked (the best ones for the
+ * CPU if it isn't set) against a scan one character at a time, for every
+ * delimiter from 0x01 to 0xff and a few sets of several.  The vector kernels
+ * read whole aligned blocks past the '\0', so every string is tried ending on
+ * every offset of a 64 byte block, and ending on the last byte of a page that
+ * is followed by one that can't be read.
+ *
+ * returns 1 if the kernels always agree, 0 otherwise.
+ */
+static int kernels_test ( void ) {
+  long const page = sysconf( _SC_PAGESIZE );
+  char *const pages = mmap( NULL, 2 * page, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+  char *const end = pages + page;
+  char block[192] __attribute__((aligned(64)));
+  TokenizerT *tk = NULL;
+  unsigned seed = 1;
+  unsigned set;
+  unsigned c;
+  size_t length;
+  int ok;
+
+  if ( pages == MAP_FAILED ) {
+    return 0;
+  }
+  ok = !mprotect( end, page, PROT_NONE ) && ( tk = TKCreate( " ", "" ) );
+  for ( set = 1; ok && set != 256 + 8; ++set ) {
+    memset( tk->delim, 0, sizeof( tk->delim ) );
+    tk->delim['\0'] = 1;
+    if ( set < 256 ) {
+      tk->delim[set] = 1;
+    }
+    else {
+      for ( c = 0; c != 12; ++c ) {
+        seed = seed * 1103515245 + 12345;
+        tk->delim[1 + ( seed >> 16 ) % ( set & 1 ? 127 : 255 )] = 1;
+      }
+    }
+    TKPickKernels( tk );
+
+    for ( length = 0; ok && length != 128; ++length ) {
+      fill_stream( block + length % 64, length, set & 255 ? set & 255 : 1,
+          &seed );
+      ok = check_kernels( tk, block + length % 64 );
+    }
+    for ( length = 0; ok && length != 96; ++length ) {
+      fill_stream( end - 1 - length, length, set & 255 ? set & 255 : 1,
+          &seed );
+      ok = check_kernels( tk, end - 1 - length );
+    }
+  }
+  if ( tk ) {
+    TKDestroy( tk );
+  }
+  munmap( pages, 2 * page );
+  return ok;
+}
+
+/*
+ * An escaped string and what it decodes to.
+ * param: length is the number of characters it decodes to, some of which may
+ * be '\0'.
+ */
+struct Escape {
+  char const *in;
+  char const *out;
+  size_t length;
+};
+
+static struct Escape const escapes[] = {
+  { "plain text, no escapes", "plain text, no escapes", 22 },
+  { "", "", 0 },
+  { "a\\tb\\n\\\\", "a\tb\n\\", 5 },
+  { "\\101\\102C", "ABC", 3 },
+  { "\\1018", "A8", 2 },
+  { "\\x41\\x4aK", "AJK", 3 },
+  { "\\x41B", "AB", 2 },
+  { "a\\000b", "a\0b", 3 },
+  { "end\\12", "end\n", 4 },
+  { "end\\x4", "end\x04", 4 },
+  { "end\\7", "end\a", 4 },
+  { "end\\x", "end\0", 4 }
+};
+
+/*
+ * escapes_test decodes every string of escapes with simplify_string and with
+ * simplify_in_place, including numeric escapes cut short by the end of the
+ * string, and checks that a string with no backslash is left as it is.
+ *
+ * returns 1 if every string decodes as expected, 0 otherwise.
+ */
+static int escapes_test ( void ) {
+  char buffer[64];
+  size_t i;
+  int ok = 1;
+
+  for ( i = 0; ok && i != sizeof( escapes ) / sizeof( escapes[0] ); ++i ) {
+    struct Escape const *const e = &escapes[i];
+    char *const copy = simplify_string( e->in );
+
+    ok = copy && !memcmp( copy, e->out, e->length ) && !copy[e->length];
+    free( copy );
+
+    strcpy( buffer, e->in );
+    ok = ok && simplify_in_place( buffer ) == e->length &&
+      !memcmp( buffer, e->out, e->length ) && !buffer[e->length];
+  }
+
+  //a string with nothing to decode is not written to at all
+  memcpy( buffer, "no backslash\0tail", 17 );
+  ok = ok && simplify_in_place( buffer ) == 12 &&
+    !memcmp( buffer, "no backslash\0tail", 17 );
+  return ok;
+}
+
+/*
+ * get_tokens_test takes tokens off of a stream with TKGetTokens in batches of
+ * different sizes, mixed with calls to TKGetNextToken, and checks them
+ * against the tokens TKGetNextToken alone returns for the same stream.
+ *
+ * returns 1 if the two sequences match, 0 otherwise.
+ */
+static int get_tokens_test ( void ) {
+  char const *const stream =
+    ",,lead; a bb,,ccc;;dddd eeeee f , ;gg hhh iiii; j,k l mm trail;, ";
+  TokenizerT *const one = TKCreate( " ,;", stream );
+  TokenizerT *const mixed = TKCreate( " ,;", stream );
+  TokenSpan spans[4];
+  char *want;
+  char *got;
+  size_t count = 0;
+  size_t used = 0;
+  unsigned step = 0;
+  int ok = one && mixed;
+
+  while ( ok && ( want = TKGetNextToken( one ) ) ) {
+    //once a batch is used up take one token, or a batch of 1 or of 4
+    if ( used == count && step++ % 3 == 0 ) {
+      ok = ( got = TKGetNextToken( mixed ) ) && !strcmp( got, want );
+      free( got );
+    }
+    else {
+      if ( used == count ) {
+        count = TKGetTokens( mixed, spans, step % 3 == 2 ? 1 : 4 );
+        used = 0;
+      }
+      ok = used != count && spans[used].length == strlen( want ) &&
+        !memcmp( mixed->head + spans[used].offset, want, strlen( want ) );
+      ++used;
+    }
+    free( want );
+  }
+  ok = ok && used == count && !TKGetTokens( mixed, spans, 4 ) &&
+    !TKGetNextToken( mixed );
+  if ( one ) {
+    TKDestroy( one );
+  }
+  if ( mixed ) {
+    TKDestroy( mixed );
+  }
+  return ok;
+}
+
+/*
+ * A delimiter set and the scanner the library has for it.
+ */
+struct Scanner {
+  char const *sepr;
+  ScanFuncT scan;
+};
+
+static struct Scanner const scanners[] = {
+  { " \t\n", TKScan_ws },
+  { "\n\t ", TKScan_ws },
+  { " ", TKScan_space },
+  { ",", TKScan_comma },
+  { "\t", TKScan_tab },
+  { "\n", TKScan_newline },
+  { ",\n", TKScan_comma_newline },
+  { "\t\n", TKScan_tab_newline }
+};
+
+/*
+ * scanners_test checks that TKFindScanner finds every specialized scanner for
+ * its delimiter set, and that the scanner splits streams of all sorts of
+ * delimiters, letters and characters of 128 and up into the same spans as
+ * TKGetTokens does.
+ *
+ * returns 1 if every scanner matches, 0 otherwise.
+ */
+static int scanners_test ( void ) {
+  static char const alphabet[] = " \t\n,ab\x80\xff";
+  char stream[4001];
+  unsigned seed = 7;
+  size_t length;
+  size_t i;
+  size_t j;
+  int ok = 1;
+
+  for ( i = 0; ok && i != sizeof( scanners ) / sizeof( scanners[0] ); ++i ) {
+    for ( length = 0; ok && length < sizeof( stream ); length += 333 ) {
+      for ( j = 0; j != length; ++j ) {
+        seed = seed * 1103515245 + 12345;
+        stream[j] = alphabet[( seed >> 16 ) % ( sizeof( alphabet ) - 1 )];
+      }
+      stream[length] = '\0';
+
+      TokenizerT *const plain = TKCreate( scanners[i].sepr, stream );
+      TokenizerT *const scanned = TKCreate( scanners[i].sepr, stream );
+      TokenSpan *want = NULL;
+      TokenSpan *got = NULL;
+      size_t nwant = 0;
+      size_t ngot = 0;
+
+      ok = plain && scanned &&
+        TKFindScanner( scanned ) == scanners[i].scan &&
+        ( want = collect_spans( plain, TKGetTokens, &nwant ) ) &&
+        ( got = collect_spans( scanned, scanners[i].scan, &ngot ) ) &&
+        nwant == ngot &&
+        !memcmp( want, got, nwant * sizeof( TokenSpan ) );
+      free( want );
+      free( got );
+      if ( plain ) {
+        TKDestroy( plain );
+      }
+      if ( scanned ) {
+        TKDestroy( scanned );
+      }
+    }
+  }
+  return ok;
+}
+
+/*
+ * byte_order compares two tokens the way memcmp would, with a token that is
+ * a prefix of the other first.
+ */
+static int byte_order ( TokenCount const *const a, TokenCount const *const b ) {
+  size_t const length = a->length < b->length ? a->length : b->length;
+  int const order = memcmp( a->token, b->token, length );
+
+  return order ? order : ( a->length > b->length ) - ( a->length < b->length );
+}
+
+/*
+ * sorted_counts_test counts a stream of tokens that share long prefixes, are
+ * prefixes of each other and hold characters of 128 and up, and checks that
+ * TKGetSortedCounts lists each of them once in byte order.  There are enough
+ * distinct tokens for the sort to be split among threads, which must give the
+ * same list as one thread.
+ *
+ * returns 1 if the lists are in order and agree, 0 otherwise.
+ */
+static int sorted_counts_test ( void ) {
+  static char const fixed[] = "abcdefgh abcdefgh0 abcdefgh\xff abcdefghij "
+    "abcdefg abcdefgh0 a ab abc a \x80 \xff\xff \xff a\x80 a\x7f ";
+  static char const alphabet[] = "ab\x7f\x80\xff";
+  size_t const ntokens = 400000;
+  char *const stream = malloc( sizeof( fixed ) + ntokens * 18 );
+  TKCounterT *const counter = TKCreateCounter( 0 );
+  TokenizerT *tk = NULL;
+  TokenCount *one = NULL;
+  TokenCount *many = NULL;
+  size_t none = 0;
+  size_t nmany = 0;
+  size_t total = 0;
+  unsigned seed = 3;
+  char *p;
+  size_t i;
+  size_t j;
+  int ok = stream && counter;
+
+  //the fixed tokens, then random ones behind a prefix of up to 8 characters
+  for ( p = stream, i = 0; ok && i != ntokens; ++i ) {
+    seed = seed * 1103515245 + 12345;
+    size_t const shared = ( seed >> 16 ) % 9;
+    size_t const length = ( seed >> 20 ) % 8 + 1;
+    memcpy( p, "prefix:_", shared );
+    for ( p += shared, j = 0; j != length; ++j ) {
+      seed = seed * 1103515245 + 12345;
+      *p++ = alphabet[( seed >> 16 ) % ( sizeof( alphabet ) - 1 )];
+    }
+    *p++ = ' ';
+  }
+  if ( ok ) {
+    strcpy( p, fixed );
+    ok = ( tk = TKCreate( " ", stream ) ) && TKCountTokens( counter, tk ) &&
+      ( one = TKGetSortedCounts( counter, 0, &none ) ) &&
+      ( many = TKGetSortedCounts( counter, 4, &nmany ) ) &&
+      none == nmany && none == counter->size && none >= ( 1 << 16 );
+  }
+  for ( i = 0; ok && i != none; ++i ) {
+    ok = ( !i || byte_order( &one[i - 1], &one[i] ) < 0 ) &&
+      one[i].token == many[i].token && one[i].count == many[i].count;
+    total += one[i].count;
+  }
+  ok = ok && total == ntokens + 15;
+  free( one );
+  free( many );
+  TKDestroyCounter( counter );
+  if ( tk ) {
+    TKDestroy( tk );
+  }
+  free( stream );
+  return ok;
+}
+
+/*
+ * check_parallel tokenizes stream on threads threads and checks that reading
+ * the chunks in order gives the same spans as tokenizing it on one thread, and
+ * that no more chunks than threads were made.
+ *
+ * returns 1 if they match, 0 otherwise.
+ */
+static int check_parallel ( char const *const stream, unsigned const threads ) {
+  TokenizerT *const one = TKCreate( " ", stream );
+  TokenizerT *const many = TKCreate( " ", stream );
+  TokenChunk *chunks = NULL;
+  TokenSpan *spans = NULL;
+  unsigned nchunks = 0;
+  size_t count = 0;
+  size_t seen = 0;
+  unsigned i;
+  size_t j;
+  int ok = one && many && ( spans = collect_spans( one, TKGetTokens, &count ) ) &&
+    ( chunks = TKParallelTokenize( many, threads, NULL, NULL, &nchunks ) ) &&
+    nchunks >= 1 && nchunks <= threads;
+
+  for ( i = 0; ok && i != nchunks; ++i ) {
+    for ( j = 0; ok && j != chunks[i].count; ++j, ++seen ) {
+      ok = seen < count &&
+        chunks[i].spans[j].offset == spans[seen].offset &&
+        chunks[i].spans[j].length == spans[seen].length;
+    }
+  }
+  ok = ok && seen == count;
+  TKDestroyChunks( chunks, nchunks );
+  free( spans );
+  if ( one ) {
+    TKDestroy( one );
+  }
+  if ( many ) {
+    TKDestroy( many );
+  }
+  return ok;
+}
+
+/*
+ * parallel_tokenize_test checks the chunks of TKParallelTokenize against a
+ * single thread for a stream too short to split among the threads asked for,
+ * a stream whose split points land in a long run of delimiters, and a stream
+ * that is one huge token.
+ *
+ * returns 1 if every stream matches, 0 otherwise.
+ */
+static int parallel_tokenize_test ( void ) {
+  size_t const length = 300000;
+  char *const stream = malloc( length + 1 );
+  size_t i;
+  int ok;
+
+  if ( !stream ) {
+    return 0;
+  }
+  ok = check_parallel( "  a bb  ccc d ", 8 );
+
+  //words, then a third of the stream that is all delimiters, then words
+  for ( i = 0; i != length; ++i ) {
+    stream[i] = i >= length / 3 && i < 2 * length / 3 ? ' '
+                : i % 5 == 4 ? ' ' : 'a' + i % 3;
+  }
+  stream[length] = '\0';
+  ok = ok && check_parallel( stream, 4 ) && check_parallel( stream, 64 );
+
+  memset( stream, 'x', length );
+  ok = ok && check_parallel( stream, 4 );
+  stream[0] = stream[length - 1] = ' ';
+  ok = ok && check_parallel( stream, 3 );
+  free( stream );
+  return ok;
+}
+
+/*
+ * A test and the name it is reported under.
+ */
+struct Test {
+  char const *name;
+  int (*run)( void );
+};
+
+static struct Test const tests[] = {
+  { "parallel_tokenize", parallel_tokenize_test },
+  { "escapes", escapes_test },
+  { "get_tokens", get_tokens_test },
+  { "scanners", scanners_test },
+  { "sorted_counts", sorted_counts_test },
+  { "arena_regrow", arena_regrow_test },
+  { "parallel_count", parallel_count_test },
+  { "kernels", kernels_test }
+};
+
+/*
+ * main runs every test and prints the ones that failed.  Build with
+ * -fsanitize=address to also catch tokens written outside their memory.
+ */
+int main ( void ) {
+  size_t failed = 0;
+  size_t i;
+
+  for ( i = 0; i != sizeof( tests ) / sizeof( tests[0] ); ++i ) {
+    if ( !tests[i].run() ) {
+      printf( "FAILED %s\n", tests[i].name );
+      ++failed;
+    }
+  }
+  printf( "%zu of %zu tests passed with the %s kernels\n",
+      sizeof( tests ) / sizeof( tests[0] ) - failed,
+      sizeof( tests ) / sizeof( tests[0] ), TKGetKernels()->name );
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
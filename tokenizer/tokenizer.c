@@ -8,29 +8,37 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "tokenizer.h"
 
-/* Tokenizer type */
-struct TokenizerT_ {
-
-  /* This points to the string of delimiters. Should never be changed. */
-  char *sepr;
-  /*
-   * This is a place holder to the front of the token string. Should never be
-   * changed.
-   */
-  char *head;
-  /* This is a pointer to the next item to tokenize. */
-  char *tail;
-};
-
-/* Use TokenizerT as the type. */
-typedef struct TokenizerT_ TokenizerT;
+/*
+ * digit_value returns the value of the character c as a digit of the given
+ * base (8 or 16), or -1 if c is not a digit of that base.
+ */
+static int digit_value ( char const c, unsigned short const base ) {
+  if ( c >= '0' && c <= '7' ) {
+    return c - '0';
+  }
+  if ( base == 8 ) {
+    return -1;
+  }
+  if ( c >= '8' && c <= '9' ) {
+    return c - '0';
+  }
+  if ( c >= 'a' && c <= 'f' ) {
+    return c - 'a' + 10;
+  }
+  if ( c >= 'A' && c <= 'F' ) {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
 
 /*
  * assign_char_from_digit takes three arguments, the pointer to the begining of
  * a string that represents some integer, the length of that string, and the
  * base that it is in.  It then converts the string to its character
- * representation and returns it.
+ * representation and returns it.  Like strtol it stops at the first character
+ * that isn't a digit, but it works straight off of s without a copy.
  */
 char assign_char_from_digit (
     char const *const s,
@@ -38,19 +46,27 @@ char assign_char_from_digit (
     unsigned short base
 ) {
 
-    char *const val = malloc( length + 1 );
-    int i;
+    long val_char = 0;
+    int digit;
+    size_t i;
 
-    for ( i = 0; i != length; ++i ) {
-      val[i] = s[i];
+    for ( i = 0; i != length && ( digit = digit_value( s[i], base ) ) >= 0;
+          ++i ) {
+      val_char = val_char * base + digit;
     }
-    val[length] = '\0';
-
-    long val_char = strtol( val, NULL, base );
-    free( val );
     return val_char;
 }
 
+/*
+ * escape_width returns how many characters of s a numeric escape of at most
+ * width digits covers.  It never reaches past the end of the string.
+ */
+static size_t escape_width ( char const *const s, size_t const width ) {
+  size_t i;
+  for ( i = 0; i != width && s[i]; ++i ) { ; /* No Operation */ }
+  return i;
+}
+
 /*
  * assign_char takes a const pointer to a constant character (immutable) and
  * returns the appropriate escape character.
@@ -74,40 +90,98 @@ char assign_char ( char const *const s ) {
   }
 }
 
+/*
+ * unescape decodes the first length characters of s into dst and terminates
+ * dst with a '\0'.  The run of plain characters in front of each backslash is
+ * found with memchr and moved in one go.  Decoding never makes a string
+ * longer, so dst may be s itself.
+ *
+ * returns the length of the decoded string.
+ */
+static size_t unescape ( char *dst, char const *s, size_t const length ) {
+  char *const start = dst;
+  char const *const end = s + length;
+  char const *backslash;
+  size_t width;
+
+  while ( ( backslash = memchr( s, '\\', end - s ) ) ) {
+    if ( dst != s ) {
+      memmove( dst, s, backslash - s );
+    }
+    dst += backslash - s;
+    s = backslash + 1;
+
+    if ( isdigit(*s) ) {
+      width = escape_width( s, 3 );
+      *dst++ = assign_char_from_digit( s, width, 8 );
+      s += width;
+    }
+    else if ( *s == 'x' ) {
+      width = escape_width( ++s, 2 );
+      *dst++ = assign_char_from_digit( s, width, 16 );
+      s += width;
+    }
+    else {
+      *dst++ = assign_char( s++ );
+    }
+  }
+
+  if ( dst != s ) {
+    memmove( dst, s, end - s );
+  }
+  dst += end - s;
+  *dst = '\0';
+  return dst - start;
+}
+
 /*
  * simplify_string takes a string with escape characters still in the form of
  * '\X' where X is some character and returns a new string and substitutes
  * escape character combinations with the actual escape character.
  */
 char *simplify_string ( char const *s ) {
-  char *iterator;
+  size_t const length = strlen( s );
   char *return_string;
-  if ( !( return_string = iterator = malloc( strlen( s ) + 1 ) ) ) {
+  if ( !( return_string = malloc( length + 1 ) ) ) {
       return NULL;
   }
 
-  for ( ; *s; ++s, ++iterator ) {
-    if ( *s == '\\' ) {
-      if ( isdigit(*++s) ) {
-        *iterator = assign_char_from_digit( s, 3, 8 );
-        s += 2;
-      }
-      else if ( *s == 'x' ) {
-        *iterator = assign_char_from_digit( ++s, 2, 16 );
-        ++s;
-      }
-      else {
-        *iterator = assign_char( s );
-      }
-    }
-    else {
-      *iterator = *s;
-    }
-  }
-  *iterator = '\0';
+  unescape( return_string, s, length );
   return return_string;
 }
 
+/*
+ * simplify_in_place does the work of simplify_string on a string the caller
+ * owns, writing the result over s instead of making a copy.  A string with no
+ * backslash in it is left untouched.
+ *
+ * returns the length of the simplified string.
+ */
+size_t simplify_in_place ( char *const s ) {
+  size_t const length = strlen( s );
+
+  if ( !memchr( s, '\\', length ) ) {
+    return length;
+  }
+  return unescape( s, s, length );
+}
+
+/*
+ * build_delim_table marks every delimiter of tk->sepr in tk->delim.  The '\0'
+ * that ends the token stream is marked as well so that a scan for the end of
+ * a token stops on it without a separate check.
+ */
+static void build_delim_table ( TokenizerT *const tk ) {
+  unsigned char const *s;
+
+  memset( tk->delim, 0, sizeof( tk->delim ) );
+  for ( s = (unsigned char const *) tk->sepr; *s; ++s ) {
+    tk->delim[*s] = 1;
+  }
+  tk->delim['\0'] = 1;
+  TKPickKernels( tk );
+}
+
 /*
  * TKCreate creates a new TokenizerT object for a given set of serarator
  * characters (given as a string) and a tken stream (given as a string).
@@ -131,6 +205,7 @@ TokenizerT *TKCreate ( char const *const seperators, char const *const ts ) {
   /* If neither string is NULL create a TokenizerT and return a pointer. */
   if ( delimiters && token && tk ) {
     *tk = (TokenizerT) {delimiters, token, token};
+    build_delim_table( tk );
     return tk;
   }
 
@@ -138,11 +213,103 @@ TokenizerT *TKCreate ( char const *const seperators, char const *const ts ) {
   return NULL;
 }
 
+/* Size of an arena block when the caller doesn't pick one. */
+#define DEFAULT_ARENA_BLOCK ( 1 << 20 )
+
+/* free_blocks frees a chain of arena blocks. */
+static void free_blocks ( ArenaBlock *block ) {
+  ArenaBlock *next;
+
+  for ( ; block; block = next ) {
+    next = block->next;
+    free( block );
+  }
+}
+
+/*
+ * arena_alloc bump allocates size bytes out of the arena of tk.  When the
+ * current block is full the next one is taken from the spare blocks kept by
+ * TKResetArena if it is big enough, or malloced otherwise.  A request bigger
+ * than a block gets a block of its own.
+ *
+ * returns a pointer to size bytes, NULL if memory could not be allocated.
+ */
+static char *arena_alloc ( TokenizerT *const tk, size_t const size ) {
+  ArenaBlock *block = tk->arena;
+
+  if ( !block || block->size - tk->arena_used < size ) {
+    if ( tk->arena_spare && size <= tk->arena_spare->size ) {
+      block = tk->arena_spare;
+      tk->arena_spare = block->next;
+    }
+    else {
+      size_t const block_size =
+        size > tk->arena_block ? size : tk->arena_block;
+      if ( !( block = malloc( sizeof( ArenaBlock ) + block_size ) ) ) {
+        return NULL;
+      }
+      block->size = block_size;
+    }
+    block->next = tk->arena;
+    tk->arena = block;
+    tk->arena_used = 0;
+  }
+
+  tk->arena_used += size;
+  return block->data + tk->arena_used - size;
+}
+
+/*
+ * TKUseArena switches tk to arena mode.  From then on TKGetNextToken bump
+ * allocates its tokens out of large blocks owned by tk instead of calling
+ * malloc for each one.  Tokens stay put and '\0' terminated until
+ * TKResetArena or TKDestroy releases them all at once, and must not be passed
+ * to free.
+ *
+ * arg: tk is the tokenizer to switch.
+ * arg: block_size is the size of an arena block in bytes, 0 picks a default.
+ */
+void TKUseArena ( TokenizerT *const tk, size_t const block_size ) {
+  size_t const size = block_size ? block_size : DEFAULT_ARENA_BLOCK;
+
+  //spare blocks of another size would never be reused as full blocks
+  if ( size != tk->arena_block ) {
+    free_blocks( tk->arena_spare );
+    tk->arena_spare = NULL;
+  }
+  tk->arena_block = size;
+}
+
+/*
+ * TKResetArena releases every token handed out in arena mode at once.  The
+ * blocks are kept to be filled again, except for ones that were made for a
+ * single oversized token.
+ */
+void TKResetArena ( TokenizerT *const tk ) {
+  ArenaBlock *block;
+  ArenaBlock *next;
+
+  for ( block = tk->arena; block; block = next ) {
+    next = block->next;
+    if ( block->size == tk->arena_block ) {
+      block->next = tk->arena_spare;
+      tk->arena_spare = block;
+    }
+    else {
+      free( block );
+    }
+  }
+  tk->arena = NULL;
+  tk->arena_used = 0;
+}
+
 /*
  * TKDestroy destroys a TokenizerT object.  It should free all dynamically
  * allocated memory that is part of the object being destroyed.
  */
 void TKDestroy ( TokenizerT *const tk ) {
+  free_blocks( tk->arena );
+  free_blocks( tk->arena_spare );
   free(tk->sepr);
   free(tk->head);
   free(tk);
@@ -151,7 +318,8 @@ void TKDestroy ( TokenizerT *const tk ) {
 /*
  * TKGetNextToken returns the next token from the token stream as a character
  * string.  Space for the returned token should be dynamically allocated.  The
- * caller is responsible for freeing the space once it is no longer needed.
+ * caller is responsible for freeing the space once it is no longer needed,
+ * unless tk is in arena mode (see TKUseArena) in which case tk owns it.
  *
  * If the function succeeds, it returns a C string (delimited by '\0')
  * containing the token.  Else it returns 0.
@@ -177,7 +345,8 @@ char *TKGetNextToken ( TokenizerT *const tk ) {
 
   /* Return the token. */
   char *ret;
-  if ( ( ret = malloc( tk->tail - head + 1 ) ) ) {
+  size_t const size = tk->tail - head + 1;
+  if ( ( ret = tk->arena_block ? arena_alloc( tk, size ) : malloc( size ) ) ) {
     ret[tk->tail - head] = '\0';
     if ( *tk->tail ) {
       ++tk->tail;
@@ -189,38 +358,44 @@ char *TKGetNextToken ( TokenizerT *const tk ) {
 }
 
 /*
- * main will have two string arguments (in argv[1] and argv[2]).
- * The first string conatins the seperator characters.
- * The second string contains the tokens.
- * Print out the tokens in the second string in left-to-right order.
- * Each token should be printed on a separate line.
+ * TKGetTokens fills spans with up to max tokens from the token stream in one
+ * pass.  The position in the stream is kept in a local for the whole batch and
+ * only written back to tk->tail at the end, and delimiters are looked up in
+ * tk->delim instead of searching tk->sepr for every character.  Tokens are not
+ * copied, each span points into tk->head.  It can be mixed freely with calls
+ * to TKGetNextToken.
+ *
+ * returns the number of spans filled in, which is less than max only when the
+ * end of the token stream has been reached.
  */
-int main ( int argc, char **argv ) {
-  char *token;
+size_t TKGetTokens ( TokenizerT *const tk, TokenSpan *const spans,
+    size_t const max ) {
+  unsigned char const *const delim = tk->delim;
+  char const *const head = tk->head;
+  char const *tail = tk->tail;
+  size_t count = 0;
 
-  /*
-   * Checks to make sure that we have the right amount of args and if
-   * the right amount of args have been supplied, try to create a
-   * TokenizerT.  Otherwise it fails and exits.
-   */
-  if ( argc != 3 ) {
-    printf("Incorrect number of arguments\n");
-    return EXIT_FAILURE;
-  }
-  TokenizerT *const tk = TKCreate( argv[1], argv[2] );
-  if ( !tk ) {
-    printf("Could not create tokenizer\n");
-    return EXIT_FAILURE;
-  }
+  while ( count != max ) {
+    /*
+     * Move past any delimiters at the front of the token.  Mostly there are
+     * none left, so the kernel is only called when there is one.
+     */
+    if ( delim[(unsigned char) *tail] ) {
+      tail = tk->find_token( tk, tail );
+    }
+    if ( !*tail ) {
+      break;
+    }
 
-  /* Iterates over the tokens and prints them out */
-  while ( ( token = TKGetNextToken(tk) ) ) {
-    printf("%s\n", token);
-    free(token);
+    /* While it isn't a delimiter (or the end) keep going. */
+    char const *const token = tail;
+    tail = tk->find_delim( tk, tail );
+    spans[count++] = (TokenSpan) { token - head, tail - token };
+    if ( *tail ) {
+      ++tail;
+    }
   }
 
-  /* Cleanup and finish. */
-  TKDestroy(tk);
-  return EXIT_SUCCESS;
+  tk->tail = (char *) tail;
+  return count;
 }
-
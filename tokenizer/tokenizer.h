@@ -0,0 +1,486 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+/*
+ * file: tokenizer.h
+ * author: David L Patrzeba (c) holder
+ * license: MIT (http://opensource.org/licenses/MIT) (c) 2013
+ */
+#include <stdlib.h>
+
+/*
+ * A block of memory that tokens are bump allocated out of in arena mode.
+ * param: next is the next block in the chain.
+ * param: size is the number of bytes in data.
+ * param: data is where the tokens go.
+ */
+struct ArenaBlock {
+  struct ArenaBlock *next;
+  size_t size;
+  char data[];
+};
+typedef struct ArenaBlock ArenaBlock;
+
+struct TokenizerT_;
+
+/*
+ * Pointer to a scanning kernel.  It is handed a tokenizer and a place in its
+ * token stream and returns the first character at or after that place that it
+ * was looking for.  The '\0' at the end of the stream always stops it.
+ */
+typedef char const *(*TKFindFuncT)(struct TokenizerT_ const *, char const *);
+
+/* Tokenizer type */
+struct TokenizerT_ {
+
+  /* This points to the string of delimiters. Should never be changed. */
+  char *sepr;
+  /*
+   * This is a place holder to the front of the token string. Should never be
+   * changed.
+   */
+  char *head;
+  /* This is a pointer to the next item to tokenize. */
+  char *tail;
+  /*
+   * This is non-zero for every character in sepr and for '\0', so a scan can
+   * classify a character with a single load.  Should never be changed.
+   */
+  unsigned char delim[256];
+  /*
+   * This is delim again for the vector kernels: bit h of nibbles[l] is set when
+   * the character 16 * h + l is a delimiter.  Should never be changed.
+   */
+  unsigned char nibbles[16];
+  /*
+   * These are the kernels picked for this CPU and these delimiters.
+   * find_delim finds the next delimiter (or the end), find_token the next
+   * character that isn't one (or the end).
+   */
+  TKFindFuncT find_delim;
+  TKFindFuncT find_token;
+  /*
+   * These are only used in arena mode, which is off while arena_block is 0.
+   * arena is the chain of blocks holding tokens, the one being filled first,
+   * and arena_used is how much of that one is filled.  arena_spare holds
+   * blocks emptied by TKResetArena.  arena_block is the size of a block.
+   */
+  ArenaBlock *arena;
+  size_t arena_used;
+  ArenaBlock *arena_spare;
+  size_t arena_block;
+};
+
+/* Use TokenizerT as the type. */
+typedef struct TokenizerT_ TokenizerT;
+
+/*
+ * A variant of the scanning kernels, built for one instruction set.
+ * param: name is "avx2", "sse" or "scalar", the names TK_KERNELS takes.
+ * param: find_delim returns the first delimiter at or after a place in the
+ * token stream, which is the '\0' at the end if there are no more.
+ * param: find_token returns the first character at or after a place in the
+ * token stream that isn't a delimiter, or the '\0' at the end.
+ */
+struct TKKernelsT_ {
+  char const *name;
+  TKFindFuncT find_delim;
+  TKFindFuncT find_token;
+};
+typedef struct TKKernelsT_ TKKernelsT;
+
+/*
+ * A token inside the token stream, described without copying it.
+ * param: offset is the index of the first character of the token counted from
+ * the front of the token stream (tk->head).
+ * param: length is the number of characters in the token.
+ */
+struct TokenSpan {
+  size_t offset;
+  size_t length;
+};
+typedef struct TokenSpan TokenSpan;
+
+/*
+ * A range of the token stream that was tokenized by one worker thread.
+ * param: index is the position of the chunk in the stream, chunk 0 is first.
+ * param: begin is the offset of the first character of the range.
+ * param: end is the offset one past the range.  It always sits on a delimiter
+ * or on the end of the stream so no token is ever split between two chunks.
+ * param: spans holds the tokens of the range in left-to-right order, NULL
+ * when the chunk was made by TKParallelVisit.
+ * param: count is the number of tokens in the range.
+ * param: data is free for a ChunkFuncT to hang per-chunk results off of.
+ */
+struct TokenChunk {
+  unsigned index;
+  size_t begin;
+  size_t end;
+  TokenSpan *spans;
+  size_t count;
+  void *data;
+};
+typedef struct TokenChunk TokenChunk;
+
+/*
+ * Pointer to a function that is run on the worker thread as soon as its chunk
+ * has been tokenized.  This lets the caller aggregate a chunk in parallel
+ * instead of walking all the spans afterwards on a single thread.
+ */
+typedef void (*ChunkFuncT)(TokenizerT const *, TokenChunk *, void *);
+
+/*
+ * Pointer to a function that TKParallelVisit runs on the worker thread for
+ * every token of a chunk, in order, with the token and its length.  It
+ * returns 0 to stop the whole run as failed, non-zero otherwise.
+ */
+typedef int (*TokenFuncT)(TokenizerT const *, TokenChunk *, char const *,
+    size_t, void *);
+
+/*
+ * simplify_string takes a string with escape characters still in the form of
+ * '\X' where X is some character and returns a new string and substitutes
+ * escape character combinations with the actual escape character.
+ */
+char *simplify_string ( char const *s );
+
+/*
+ * simplify_in_place substitutes the escape characters of s like
+ * simplify_string, but over s itself so no copy is made.  It returns the
+ * length of the simplified string.
+ */
+size_t simplify_in_place ( char *const s );
+
+/* Formats the output stage can write tokens in. */
+#define TK_OUTPUT_LINES 0
+#define TK_OUTPUT_NUL 1
+#define TK_OUTPUT_BINARY 2
+
+/*
+ * A buffered output stage for tokens.
+ * param: fd is the file descriptor the tokens are written to.
+ * param: format is one of the TK_OUTPUT_ formats.
+ * param: buffer holds the bytes that haven't been written yet.
+ * param: used is the number of bytes in the buffer.
+ * param: capacity is the size of the buffer.
+ * param: failed is set once a write has failed, nothing is written after.
+ */
+struct TKOutputT_ {
+  int fd;
+  int format;
+  char *buffer;
+  size_t used;
+  size_t capacity;
+  int failed;
+};
+typedef struct TKOutputT_ TKOutputT;
+
+/*
+ * The number of times a token has been counted.
+ * param: token points at the first character of the token, which isn't copied.
+ * NULL marks an empty slot of a counter.
+ * param: length is the number of characters in the token.
+ * param: hash is the hash of the token, kept so it is never computed twice.
+ * param: count is the number of times the token was seen.
+ */
+struct TokenCount {
+  char const *token;
+  size_t length;
+  size_t hash;
+  size_t count;
+};
+typedef struct TokenCount TokenCount;
+
+/*
+ * Counter type, an open addressing hash table of TokenCounts.
+ * param: slots is the table, capacity is always a power of 2.
+ * param: capacity is the number of slots.
+ * param: size is the number of distinct tokens in the table.
+ */
+struct TKCounterT_ {
+  TokenCount *slots;
+  size_t capacity;
+  size_t size;
+};
+typedef struct TKCounterT_ TKCounterT;
+
+/*
+ * TKCreate creates a new TokenizerT object for a given set of serarator
+ * characters (given as a string) and a tken stream (given as a string).
+ *
+ * If the function succeeds, it returns a non-NULL TokenizerT.
+ * Else it returns NULL.
+ */
+TokenizerT *TKCreate ( char const *const seperators, char const *const ts );
+
+/*
+ * TKDestroy destroys a TokenizerT object.  It should free all dynamically
+ * allocated memory that is part of the object being destroyed.
+ */
+void TKDestroy ( TokenizerT *const tk );
+
+/*
+ * TKUseArena switches tk to arena mode: TKGetNextToken hands out tokens bump
+ * allocated out of blocks of block_size bytes (0 picks a default) owned by tk.
+ * They must not be freed by the caller, TKResetArena or TKDestroy release
+ * them all at once.
+ */
+void TKUseArena ( TokenizerT *const tk, size_t const block_size );
+
+/*
+ * TKResetArena releases every token handed out in arena mode, keeping the
+ * blocks around for the tokens still to come.
+ */
+void TKResetArena ( TokenizerT *const tk );
+
+/*
+ * TKGetNextToken returns the next token from the token stream as a character
+ * string.  The caller is responsible for freeing the space once it is no
+ * longer needed, unless tk is in arena mode.
+ *
+ * If the function succeeds, it returns a C string (delimited by '\0')
+ * containing the token.  Else it returns 0.
+ */
+char *TKGetNextToken ( TokenizerT *const tk );
+
+/*
+ * TKGetTokens fills spans with up to max tokens from the token stream without
+ * copying them.  It returns the number of spans filled in, which is less than
+ * max only when the end of the token stream has been reached.
+ */
+size_t TKGetTokens ( TokenizerT *const tk, TokenSpan *const spans,
+    size_t const max );
+
+/*
+ * Pointer to a scanner, a function that is called exactly like TKGetTokens.
+ */
+typedef size_t (*ScanFuncT)(TokenizerT *const, TokenSpan *const, size_t const);
+
+/*
+ * TK_DEFINE_SCANNER defines TKScan_name, a version of TKGetTokens specialized
+ * for a delimiter set that is known when compiling, e.g.
+ *
+ *   TK_DEFINE_SCANNER(ws, " \t\n")
+ *
+ * The set is a string literal, so the test for a delimiter unrolls into a few
+ * compares against constants instead of a load from tk->delim, and the scan
+ * over the characters of a token is unrolled four characters at a time.  The
+ * delimiters of the TokenizerT handed to it are not looked at.
+ */
+#define TK_DEFINE_SCANNER(name, set)                                          \
+static inline int TKIsSepr_##name ( unsigned char const c ) {                 \
+  static char const sepr[] = set;                                             \
+  size_t i;                                                                   \
+  for ( i = 0; i != sizeof( sepr ) - 1; ++i ) {                               \
+    if ( c == (unsigned char) sepr[i] ) {                                     \
+      return 1;                                                               \
+    }                                                                         \
+  }                                                                           \
+  return !c;                                                                  \
+}                                                                             \
+size_t TKScan_##name ( TokenizerT *const tk, TokenSpan *const spans,          \
+    size_t const max ) {                                                      \
+  unsigned char const *tail = (unsigned char const *) tk->tail;               \
+  size_t count = 0;                                                           \
+                                                                              \
+  while ( count != max ) {                                                    \
+    while ( *tail && TKIsSepr_##name( *tail ) ) {                             \
+      ++tail;                                                                 \
+    }                                                                         \
+    if ( !*tail ) {                                                           \
+      break;                                                                  \
+    }                                                                         \
+                                                                              \
+    unsigned char const *const token = tail;                                  \
+    for ( ;; tail += 4 ) {                                                    \
+      if ( TKIsSepr_##name( tail[0] ) ) { break; }                            \
+      if ( TKIsSepr_##name( tail[1] ) ) { tail += 1; break; }                 \
+      if ( TKIsSepr_##name( tail[2] ) ) { tail += 2; break; }                 \
+      if ( TKIsSepr_##name( tail[3] ) ) { tail += 3; break; }                 \
+    }                                                                         \
+    spans[count++] = (TokenSpan) {                                            \
+      (char const *) token - tk->head, tail - token };                        \
+    if ( *tail ) {                                                            \
+      ++tail;                                                                 \
+    }                                                                         \
+  }                                                                           \
+                                                                              \
+  tk->tail = (char *) tail;                                                   \
+  return count;                                                               \
+}
+
+/* Scanners defined by the library for the delimiter sets used the most. */
+size_t TKScan_ws ( TokenizerT *const, TokenSpan *const, size_t const );
+size_t TKScan_space ( TokenizerT *const, TokenSpan *const, size_t const );
+size_t TKScan_comma ( TokenizerT *const, TokenSpan *const, size_t const );
+size_t TKScan_tab ( TokenizerT *const, TokenSpan *const, size_t const );
+size_t TKScan_newline ( TokenizerT *const, TokenSpan *const, size_t const );
+size_t TKScan_comma_newline ( TokenizerT *const, TokenSpan *const,
+    size_t const );
+size_t TKScan_tab_newline ( TokenizerT *const, TokenSpan *const,
+    size_t const );
+
+/*
+ * TKFindScanner returns the library scanner specialized for the delimiters of
+ * tk, or NULL if there isn't one.
+ */
+ScanFuncT TKFindScanner ( TokenizerT const *const tk );
+
+/*
+ * TKGetKernels returns the scanning kernels for the CPU the program runs on,
+ * the widest vector variant it has unless the TK_KERNELS environment variable
+ * names another one it can run.  They are picked once, on the first call.
+ */
+TKKernelsT const *TKGetKernels ( void );
+
+/*
+ * TKPickKernels fills in tk->nibbles from tk->delim and points tk at the
+ * kernels for its delimiters.  TKCreate calls it, it only has to be called
+ * again if tk->delim is changed by hand.
+ */
+void TKPickKernels ( TokenizerT *const tk );
+
+/*
+ * TKParallelTokenize splits the rest of the token stream into one range per
+ * thread, moves every split point forward onto a delimiter and tokenizes the
+ * ranges on worker threads.  If func is not NULL it is called on the worker
+ * with each finished chunk and arg.  Reading the chunks from 0 to *nchunks - 1
+ * gives the tokens in their original order.  The token stream is consumed.
+ *
+ * If the function succeeds, it returns an array of *nchunks TokenChunks that
+ * must be released with TKDestroyChunks.  Else it returns NULL.
+ */
+TokenChunk *TKParallelTokenize (
+    TokenizerT *const tk,
+    unsigned threads,
+    ChunkFuncT func,
+    void *arg,
+    unsigned *nchunks
+);
+
+/*
+ * TKParallelVisit splits the token stream like TKParallelTokenize, but calls
+ * func on the worker with every token as it is found instead of recording
+ * spans, so no memory is used per token.  The chunks it returns only carry
+ * their ranges and token counts.
+ *
+ * If the function succeeds, it returns an array of *nchunks TokenChunks that
+ * must be released with TKDestroyChunks.  Else it returns NULL.
+ */
+TokenChunk *TKParallelVisit (
+    TokenizerT *const tk,
+    unsigned threads,
+    TokenFuncT func,
+    void *arg,
+    unsigned *nchunks
+);
+
+/*
+ * TKDestroyChunks frees an array of chunks made by TKParallelTokenize or
+ * TKParallelVisit.
+ */
+void TKDestroyChunks ( TokenChunk *chunks, unsigned nchunks );
+
+/*
+ * TKCreateOutput creates an output stage that writes tokens to fd in the given
+ * format through a buffer of size bytes (0 picks a default).
+ *
+ * If the function succeeds, it returns a non-NULL TKOutputT.
+ * Else it returns NULL.
+ */
+TKOutputT *TKCreateOutput ( int const fd, int const format, size_t size );
+
+/*
+ * TKWriteToken adds a token of length characters to the output.
+ *
+ * If the function succeeds, it returns 1.  Else, it returns 0.
+ */
+int TKWriteToken ( TKOutputT *const out, char const *const token,
+    size_t const length );
+
+/*
+ * TKWriteSpans adds count tokens of the token stream head to the output.
+ *
+ * If the function succeeds, it returns 1.  Else, it returns 0.
+ */
+int TKWriteSpans ( TKOutputT *const out, char const *const head,
+    TokenSpan const *const spans, size_t const count );
+
+/*
+ * TKFlushOutput writes out everything that is buffered.
+ *
+ * If the function succeeds, it returns 1.  Else, it returns 0.
+ */
+int TKFlushOutput ( TKOutputT *const out );
+
+/*
+ * TKDestroyOutput flushes and frees an output stage.
+ *
+ * If everything was written, it returns 1.  Else, it returns 0.
+ */
+int TKDestroyOutput ( TKOutputT *const out );
+
+/*
+ * TKCreateCounter creates an empty counter sized for about expected distinct
+ * tokens.  Counted tokens are not copied and must outlive the counter.
+ *
+ * If the function succeeds, it returns a non-NULL TKCounterT.
+ * Else it returns NULL.
+ */
+TKCounterT *TKCreateCounter ( size_t const expected );
+
+/*
+ * TKCountToken adds one to the count of a token of length characters.
+ *
+ * If the function succeeds, it returns 1.  Else, it returns 0.
+ */
+int TKCountToken ( TKCounterT *const counter, char const *const token,
+    size_t const length );
+
+/*
+ * TKCountTokens counts every token left in the token stream.
+ *
+ * If the function succeeds, it returns 1.  Else, it returns 0.
+ */
+int TKCountTokens ( TKCounterT *const counter, TokenizerT *const tk );
+
+/*
+ * TKParallelCount counts every token left in the token stream on up to threads
+ * threads.
+ *
+ * If the function succeeds, it returns 1.  Else, it returns 0.
+ */
+int TKParallelCount ( TKCounterT *const counter, TokenizerT *const tk,
+    unsigned const threads );
+
+/*
+ * TKMergeCounter adds every count of from to into.
+ *
+ * If the function succeeds, it returns 1.  Else, it returns 0.
+ */
+int TKMergeCounter ( TKCounterT *const into, TKCounterT const *const from );
+
+/*
+ * TKGetCounts lists the top most frequent tokens (all of them if top is 0),
+ * most frequent first and ties in byte order, and sets *count to the number
+ * listed.
+ *
+ * If the function succeeds, it returns an array the caller must free.
+ * Else it returns NULL.
+ */
+TokenCount *TKGetCounts ( TKCounterT const *const counter, size_t top,
+    size_t *const count );
+
+/*
+ * TKGetSortedCounts lists every counted token once in byte order, sorting on
+ * up to threads threads, and sets *count to the number listed.
+ *
+ * If the function succeeds, it returns an array the caller must free.
+ * Else it returns NULL.
+ */
+TokenCount *TKGetSortedCounts ( TKCounterT const *const counter,
+    unsigned const threads, size_t *const count );
+
+/* TKDestroyCounter frees a counter.  The counted tokens are not touched. */
+void TKDestroyCounter ( TKCounterT *const counter );
+
+#endif